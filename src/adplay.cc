@@ -21,15 +21,26 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <math.h>
 #include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <vector>
 #include <adplug/adplug.h>
-#include <adplug/emuopl.h>
-#include <adplug/kemuopl.h>
-#include <adplug/wemuopl.h>
 #include <adplug/diskopl.h>
+#include <adplug/silentopl.h>
 
 #include "defines.h"
 
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 /*
  * Sun systems declare getopt in unistd.h,
  * other systems (Linux, Apple) use getopt.h.
@@ -46,57 +57,129 @@
 #	endif
 #endif
 
-#ifdef HAVE_ADPLUG_NUKEDOPL
-#include <adplug/nemuopl.h>
-#endif
-#ifdef HAVE_ADPLUG_SURROUND
-#include <adplug/surroundopl.h>
-#endif
-
 #include "output.h"
 #include "players.h"
+#include "emu.h"
+#include "daemon.h"
+#include "cache.h"
+#include "provider.h"
+#include "loader.h"
+#include "dbcache.h"
+#include "parallel.h"
+#include "library.h"
+#include "probes.h"
+#include "compare.h"
+#include "loop.h"
+#include "stems.h"
+#include "control.h"
+#include "playlist.h"
+#include "idle.h"
 
 /***** Defines *****/
 
-// Default file name of AdPlug's database file
-#define ADPLUGDB_FILE		"adplug.db"
+// Default realtime priority of the render thread
+#define RT_PRIORITY		50
 
-// Default AdPlug user's configuration subdirectory
-#define ADPLUG_CONFDIR		".adplug"
+// Default burst length of the power saving mode (in seconds)
+#define POWERSAVE_BURST		2
+
+// Amount of stack to prefault before realtime playback
+#define RT_STACK_PREFAULT	(64 * 1024)
+
+// Value of cfg.subsong to play all subsongs
+#define ALL_SUBSONGS		((unsigned int)-2)
+
+// Default size limit of the render cache (in MB)
+#define CACHE_SIZE		1024
+
+// Longest render compared by --compare (in seconds)
+#define COMPARE_MAXLEN		(10 * 60)
+
+// Longest render split into --stems (in seconds)
+#define STEMS_MAXLEN		(15 * 60)
+
+// Number of upcoming files to have read in advance
+#define READAHEAD_FILES		3
+
+// Time to wait for control commands at once while paused (in ms)
+#define CONTROL_WAIT		50
+
+// Default silence that ends a song with --stop-on-silence (in seconds)
+#define SILENCE_LIMIT		5
 
-// Default path to AdPlug's system-wide database file
-#ifdef ADPLUG_DATA_DIR
-#  define ADPLUGDB_PATH		ADPLUG_DATA_DIR "/" ADPLUGDB_FILE
-#else
-#  define ADPLUGDB_PATH		ADPLUGDB_FILE
-#endif
 
 /***** Typedefs *****/
 
-typedef enum {
-	Emu_Satoh,
-	Emu_Ken,
-	Emu_Woody,
-#ifdef HAVE_ADPLUG_NUKEDOPL
-	Emu_Nuked,
-#endif
-} EmuType;
+// Long options without a short equivalent
+enum {
+  OPT_RTPRIO = 256,
+  OPT_POWERSAVE,
+  OPT_DAEMON,
+  OPT_CACHE,
+  OPT_CACHE_SIZE,
+  OPT_PROBE,
+  OPT_INDEX,
+  OPT_STATS,
+  OPT_COMPARE,
+  OPT_DETECT_LOOPS,
+  OPT_STOP_ON_SILENCE,
+  OPT_TRIM,
+  OPT_SKIP_IDLE,
+  OPT_FADE,
+  OPT_LOUDNESS,
+  OPT_STEMS,
+  OPT_CONTROL,
+  OPT_FILES_FROM,
+  OPT_RECURSIVE
+};
 
 /***** Global variables *****/
 
 static const char	*program_name;
 static Player		*player = 0;		// global player object
 static CAdPlugDatabase	mydb;
+static DatabaseCache	dbcache(mydb);
 static Copl		*opl = 0;
+static RenderCache	*cache = 0;		// render cache, if enabled
+static LoaderIndex	loaders;
+static EmuType		compare_emus[2];	// emulators to --compare
+static SilenceFilter	*silence = 0;		// silence detection, if enabled
+static KeyTracker	*keytracker = 0;	// key ons for silence detection
+static IdleTracker	*idletracker = 0;	// idle chip, with --skip-idle
+static Copl		*verifyopl = 0;		// with --skip-idle=verify
+static TeeOpl		*verifytee = 0;
+static Copl		*frontopl = 0;		// chip that players write to
+static Loudness		*loudness = 0;		// with --analyze-loudness
+static Loudness		*totalloudness = 0;	// of all songs in the output
+static ControlChannel	*control = 0;		// playback control, if enabled
+static MuteOpl		*muteopl = 0;		// channel muting for control
+static ControlChannel::Command control_end = ControlChannel::None;
+
+// Set by the signal handler to end the render loop
+static volatile sig_atomic_t	rendering = 0, interrupted = 0;
+
+// Render loop stage timing, collected with --stats
+static FrameStats	filestats, totalstats;
+static unsigned int	statfiles = 0;
+
+// Render loop timing, collected with realtime priority enabled
+static struct {
+  double		last, sum, max;
+  unsigned long		count;
+} rtstats = { 0, 0, 0, 0 };
 
 /***** Configuration (and defaults) *****/
 
 static struct {
   int			buf_size, freq, channels, bits, harmonic, message_level;
-  unsigned int		subsong, loops;
-  const char		*device;
+  int			rtprio, powersave, skipidle, loudness;
+  double		silence, fade;
+  unsigned int		subsong, loops, jobs, cache_size;
+  const char		*device, *daemon, *cache, *index, *controlfifo;
+  const char		*filesfrom;
   char			*userdb;
-  bool			endless, showinsts, songinfo, songmessage;
+  bool			endless, showinsts, songinfo, songmessage, probe, stats;
+  bool			compare, detectloops, trim, stems, control, recursive;
   EmuType		emutype;
   Outputs		output;
 } cfg = {
@@ -107,10 +190,14 @@ static struct {
   1, 16, 0,  // Else default to mono (until stereo w/ single OPL is fixed)
 #endif
   MSG_NOTE,
-  (unsigned int)-1, 1,
+  0, 0, 0, 0,
+  0, 0,
+  (unsigned int)-1, 1, 0, CACHE_SIZE,
+  NULL, NULL, NULL, NULL, NULL,
   NULL,
   NULL,
-  true, false, false, false,
+  true, false, false, false, false, false,
+  false, false, false, false, false, false,
   Emu_Woody,
   DEFAULT_DRIVER
 };
@@ -159,11 +246,20 @@ static void usage()
 #ifdef DRIVER_ALSA
 	 "ALSA driver (alsa) specific:\n"
 	 "  -d, --device=DEVICE        set sound device to DEVICE\n"
-	 "  -b, --buffer=SIZE          set output buffer size to SIZE\n\n"
+	 "  -b, --buffer=SIZE          set output buffer size to SIZE\n"
+	 "      --powersave[=SECONDS]  render ahead in bursts of SECONDS\n\n"
+#endif
+#ifdef DRIVER_HTTP
+	 "HTTP streamer (http) specific:\n"
+	 "  -d, --device=[HOST:]PORT   listen for listeners on HOST:PORT\n\n"
 #endif
 #ifdef DRIVER_RAW
 	 "RAW file writer (raw) specific:\n"
 	 "  -d, --device=FILE          output to FILE\n\n"
+#endif
+#ifdef DRIVER_HASH
+	 "Hash writer (hash) specific:\n"
+	 "  -d, --device=FILE          write hash to FILE (default stdout)\n\n"
 #endif
 	 "Playback quality:\n"
 	 "  -8, --8bit                 8-bit sample quality\n"
@@ -175,13 +271,33 @@ static void usage()
 	 "Informative output:\n"
 	 "  -i, --instruments          display instrument names\n"
 	 "  -r, --realtime             display realtime song info\n"
-	 "  -m, --message              display song message\n\n"
+	 "  -m, --message              display song message\n"
+	 "      --probe                print song information as JSON lines\n"
+	 "      --index=FILE           update song index FILE for the given paths\n"
+	 "      --stats                report render timing after each file\n"
+	 "      --compare=EMU1,EMU2    compare the output of two emulators\n"
+	 "      --analyze-loudness[=normalize] measure (and normalize) loudness\n\n"
 	 "Playback:\n"
-	 "  -s, --subsong=N            play subsong number N\n"
+	 "  -s, --subsong=N            play subsong number N, or all of them\n"
 	 "  -o, --once                 play only once, don't loop\n"
-	 "  -l, --loop=N               loop exactly N times\n\n"
+	 "  -l, --loop=N               loop exactly N times\n"
+	 "      --detect-loops         find the song's loop to end it exactly\n"
+	 "      --stop-on-silence[=SECONDS] end songs after SECONDS of silence\n"
+	 "      --trim                 drop silence at the start and end of songs\n"
+	 "      --fade=SECONDS         fade out over the last SECONDS of songs\n"
+	 "      --skip-idle[=verify]   don't emulate while all notes are silent\n"
+	 "      --stems                render each channel into its own file\n"
+	 "      --control[=FIFO]       take playback commands from stdin or FIFO\n"
+	 "      --files-from=FILE      also play the NUL separated files in FILE\n"
+	 "      --recursive            play all files below given directories\n"
+	 "      --realtime-priority[=N] render with realtime priority N\n"
+	 "      --cache=DIR            cache rendered songs in DIR\n"
+	 "      --cache-size=MB        limit the cache to MB megabytes\n\n"
+	 "Render daemon:\n"
+	 "      --daemon=SOCKET        serve render requests on SOCKET\n\n"
 	 "Generic:\n"
 	 "  -D, --database=FILE        additionally use database file FILE\n"
+	 "  -j, --jobs=N               use N worker processes\n"
 	 "  -q, --quiet                be more quiet\n"
 	 "  -v, --verbose              be more verbose\n"
 	 "  -h, --help                 display this help and exit\n"
@@ -221,6 +337,12 @@ static void usage()
 #endif
 #ifdef DRIVER_RAW
 	 " raw"
+#endif
+#ifdef DRIVER_HASH
+	 " hash"
+#endif
+#ifdef DRIVER_HTTP
+	 " http"
 #endif
 	 "\n");
 }
@@ -244,20 +366,40 @@ static int decode_switches(int argc, char **argv)
     {"instruments", no_argument, NULL, 'i'},	// show instruments
     {"realtime", no_argument, NULL, 'r'},	// realtime song info
     {"message", no_argument, NULL, 'm'},	// song message
-    {"subsong", no_argument, NULL, 's'},	// play subsong
+    {"subsong", required_argument, NULL, 's'},	// play subsong
     {"once", no_argument, NULL, 'o'},		// don't loop
     {"loop", required_argument, NULL, 'l'},	// loop count
+    {"realtime-priority", optional_argument, NULL, OPT_RTPRIO}, // SCHED_FIFO
+    {"powersave", optional_argument, NULL, OPT_POWERSAVE}, // burst rendering
     {"help", no_argument, NULL, 'h'},		// display help
     {"version", no_argument, NULL, 'V'},	// version information
     {"emulator", required_argument, NULL, 'e'},	// emulator to use
     {"output", required_argument, NULL, 'O'},	// output mechanism
     {"database", required_argument, NULL, 'D'},	// different database
+    {"jobs", required_argument, NULL, 'j'},	// worker processes
+    {"daemon", required_argument, NULL, OPT_DAEMON}, // render daemon
+    {"cache", required_argument, NULL, OPT_CACHE}, // render cache directory
+    {"cache-size", required_argument, NULL, OPT_CACHE_SIZE}, // in MB
+    {"probe", no_argument, NULL, OPT_PROBE},	// print song info as JSON
+    {"index", required_argument, NULL, OPT_INDEX}, // update song index
+    {"stats", no_argument, NULL, OPT_STATS},	// render timing statistics
+    {"compare", required_argument, NULL, OPT_COMPARE}, // compare emulators
+    {"detect-loops", no_argument, NULL, OPT_DETECT_LOOPS}, // find loop point
+    {"stop-on-silence", optional_argument, NULL, OPT_STOP_ON_SILENCE},
+    {"trim", no_argument, NULL, OPT_TRIM},	// trim silence
+    {"skip-idle", optional_argument, NULL, OPT_SKIP_IDLE}, // idle fast path
+    {"fade", required_argument, NULL, OPT_FADE},	// fade out at the end
+    {"analyze-loudness", optional_argument, NULL, OPT_LOUDNESS}, // R128
+    {"stems", no_argument, NULL, OPT_STEMS},		// a file per channel
+    {"control", optional_argument, NULL, OPT_CONTROL},	// playback commands
+    {"files-from", required_argument, NULL, OPT_FILES_FROM}, // file list
+    {"recursive", no_argument, NULL, OPT_RECURSIVE},	// expand directories
     {"quiet", no_argument, NULL, 'q'},		// be more quiet
     {"verbose", no_argument, NULL, 'v'},	// be more verbose
     {NULL, 0, NULL, 0}				// end of options
   };
 
-  while ((c = getopt_long(argc, argv, "8f:b:d:irms:ol:hVe:O:D:qv",
+  while ((c = getopt_long(argc, argv, "8f:b:d:irms:ol:hVe:O:D:j:qv",
 			  long_options, (int *)0)) != EOF) {
       switch (c) {
       case '8': cfg.bits = 8; break;
@@ -271,15 +413,65 @@ static int decode_switches(int argc, char **argv)
       case 'i': cfg.showinsts = true; break;
       case 'r': cfg.songinfo = true; break;
       case 'm': cfg.songmessage = true; break;
-      case 's': cfg.subsong = atoi(optarg); break;
+      case 's':
+	cfg.subsong = strcmp(optarg, "all") ? atoi(optarg) : ALL_SUBSONGS;
+	break;
       case 'o': cfg.endless = false; break;
       case 'l': cfg.endless = false; cfg.loops = atoi(optarg); break;
-      case 'V': puts(ADPLAY_VERSION); exit(EXIT_SUCCESS);
-      case 'h':	usage(); exit(EXIT_SUCCESS); break;
-      case 'D':
-	if(!mydb.load(optarg))
-	  message(MSG_WARN, "could not open database -- %s", optarg);
+      case OPT_RTPRIO: cfg.rtprio = optarg ? atoi(optarg) : RT_PRIORITY; break;
+      case 'j': cfg.jobs = atoi(optarg); break;
+      case OPT_DAEMON: cfg.daemon = optarg; break;
+      case OPT_CACHE: cfg.cache = optarg; break;
+      case OPT_CACHE_SIZE: cfg.cache_size = atoi(optarg); break;
+      case OPT_PROBE: cfg.probe = true; break;
+      case OPT_INDEX: cfg.index = optarg; break;
+      case OPT_STATS: cfg.stats = true; break;
+      case OPT_DETECT_LOOPS: cfg.detectloops = true; break;
+      case OPT_STOP_ON_SILENCE:
+	cfg.silence = optarg ? atof(optarg) : SILENCE_LIMIT;
+	break;
+      case OPT_TRIM: cfg.trim = true; break;
+      case OPT_FADE: cfg.fade = atof(optarg); break;
+      case OPT_STEMS: cfg.stems = true; break;
+      case OPT_CONTROL: cfg.control = true; cfg.controlfifo = optarg; break;
+      case OPT_FILES_FROM: cfg.filesfrom = optarg; break;
+      case OPT_RECURSIVE: cfg.recursive = true; break;
+      case OPT_LOUDNESS:
+	if(optarg && strcmp(optarg, "normalize")) {
+	  message(MSG_ERROR, "unknown loudness mode -- %s", optarg);
+	  exit(EXIT_FAILURE);
+	}
+	cfg.loudness = optarg ? 2 : 1;
+	break;
+      case OPT_SKIP_IDLE:
+	if(optarg && strcmp(optarg, "verify")) {
+	  message(MSG_ERROR, "unknown idle skipping mode -- %s", optarg);
+	  exit(EXIT_FAILURE);
+	}
+	cfg.skipidle = optarg ? 2 : 1;
 	break;
+      case OPT_COMPARE: {
+	std::string	emus = optarg;
+	size_t		comma = emus.find(',');
+
+	if(comma == std::string::npos ||
+	   !emu_lookup(emus.substr(0, comma).c_str(), &compare_emus[0]) ||
+	   !emu_lookup(emus.substr(comma + 1).c_str(), &compare_emus[1])) {
+	  message(MSG_ERROR, "need two emulators to compare -- %s", optarg);
+	  exit(EXIT_FAILURE);
+	}
+	cfg.compare = true;
+	break;
+      }
+      case OPT_POWERSAVE:
+	cfg.powersave = optarg ? atoi(optarg) : POWERSAVE_BURST;
+	break;
+      case 'V':
+	printf("%s\nAdPlug %s\n", ADPLAY_VERSION,
+	       CAdPlug::get_version().c_str());
+	exit(EXIT_SUCCESS);
+      case 'h':	usage(); exit(EXIT_SUCCESS); break;
+      case 'D': dbcache.addsource(optarg, true); break;
       case 'O':
 #ifdef DRIVER_OSS
 	if(!strcmp(optarg,"oss")) cfg.output = oss;
@@ -316,12 +508,23 @@ static int decode_switches(int argc, char **argv)
 	if(!strcmp(optarg,"ao")) cfg.output = ao;
 	else
 #endif
+#ifdef DRIVER_HTTP
+	if(!strcmp(optarg,"http")) cfg.output = http;
+	else
+#endif
 #ifdef DRIVER_RAW
 	if(!strcmp(optarg,"raw")) {
 	  cfg.output = raw;
 	  cfg.endless = false; // endless output is almost never desired here
 	}
 	else
+#endif
+#ifdef DRIVER_HASH
+	if(!strcmp(optarg,"hash")) {
+	  cfg.output = hash;
+	  cfg.endless = false;
+	}
+	else
 #endif
 	{
 	  message(MSG_ERROR, "unknown output method -- %s", optarg);
@@ -329,16 +532,11 @@ static int decode_switches(int argc, char **argv)
 	}
 	break;
       case 'e':
-	if(!strcmp(optarg, "satoh")) cfg.emutype = Emu_Satoh;
-	else if(!strcmp(optarg, "ken")) cfg.emutype = Emu_Ken;
-	else if(!strcmp(optarg, "woody")) cfg.emutype = Emu_Woody;
-#ifdef HAVE_ADPLUG_NUKEDOPL
-	else if(!strcmp(optarg, "nuked")) cfg.emutype = Emu_Nuked;
-#endif
-	else {
+	if(!emu_lookup(optarg, &cfg.emutype)) {
 	  message(MSG_ERROR, "unknown emulator -- %s", optarg);
 	  exit(EXIT_FAILURE);
 	}
+	break;
       case 'q': if(cfg.message_level) cfg.message_level--; break;
       case 'v': cfg.message_level++; break;
       }
@@ -348,23 +546,420 @@ static int decode_switches(int argc, char **argv)
   return optind;
 }
 
-static void play(const char *fn, Player *pl, int subsong = -1)
+static void set_realtime(int prio)
+/*
+ * Lock all memory and switch the calling (render) thread to SCHED_FIFO
+ * with priority 'prio'. Falls back to normal scheduling if not permitted.
+ */
+{
+#ifdef HAVE_MLOCKALL
+  if(mlockall(MCL_CURRENT | MCL_FUTURE))
+    message(MSG_WARN, "cannot lock memory -- %s", strerror(errno));
+  else {
+    // Prefault the stack, so the render loop never has to grow it. The
+    // writes are volatile, so they can't be optimized away.
+    volatile char	stack[RT_STACK_PREFAULT];
+    long		page = sysconf(_SC_PAGESIZE), i;
+
+    if(page <= 0) page = 4096;
+    for(i = 0; i < RT_STACK_PREFAULT; i += page) stack[i] = 0;
+    stack[RT_STACK_PREFAULT - 1] = 0;
+  }
+#endif
+
+#ifdef HAVE_SCHED_SETSCHEDULER
+  struct sched_param param;
+  int pmin = sched_get_priority_min(SCHED_FIFO);
+  int pmax = sched_get_priority_max(SCHED_FIFO);
+
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = MAX(pmin, MIN(pmax, prio));
+  if(sched_setscheduler(0, SCHED_FIFO, &param))
+    message(MSG_WARN, "cannot set realtime priority, using normal "
+	    "scheduling -- %s", strerror(errno));
+  else
+    message(MSG_DEBUG, "using realtime priority %d", param.sched_priority);
+#else
+  message(MSG_WARN, "realtime priority not supported on this system");
+#endif
+}
+
+static void rt_measure()
+/* Record the time since the last call, i.e. one render loop period. */
+{
+  double now = FrameStats::now() / 1000000.0, interval;	// in ms
+
+  if(rtstats.last) {
+    interval = now - rtstats.last;
+    rtstats.sum += interval;
+    rtstats.max = MAX(rtstats.max, interval);
+    rtstats.count++;
+  }
+  rtstats.last = now;
+}
+
+static void rt_report()
+/*
+ * Report the observed render loop periods. The worst period in excess
+ * of the average is the scheduling latency the output buffer must cover.
+ */
+{
+  double avg;
+
+  if(!rtstats.count) return;
+  avg = rtstats.sum / rtstats.count;
+  message(MSG_NOTE, "render period: avg %.2f ms, max %.2f ms, "
+	  "worst latency %.2f ms", avg, rtstats.max, rtstats.max - avg);
+  rtstats.last = rtstats.sum = rtstats.max = 0;
+  rtstats.count = 0;
+}
+
+static CPlayer *load(const char *fn, Copl *opl, const MmapProvider &fp)
+/*
+ * Construct a player for file 'fn', read through 'fp', with its database
+ * record at hand.
+ */
+{
+  binistream	*f = fp.open(fn);
+  CPlayer	*p;
+
+  PROBE_LOAD_START(fn);
+  if(f) {
+    dbcache.fetch(*f);
+    fp.close(f);
+  }
+
+  p = loaders.factory(fn, opl, fp);
+  PROBE_LOAD_DONE(fn, p != 0);
+  return p;
+}
+
+static char **probe_files;
+
+static void describe(const char *fn, bool lengths, FILE *out)
+/* Write the information on file 'fn' as JSON object members. */
+{
+  MmapProvider	fp(fn);
+  CSilentopl	silent;
+  CPlayer	*p = load(fn, &silent, fp);
+  unsigned int	i;
+
+  if(!p) {
+    fputs(",\"error\":\"unknown filetype\"", out);
+    return;
+  }
+
+  fprintf(out, ",\"type\":%s", json_string(p->gettype()).c_str());
+  fprintf(out, ",\"title\":%s", json_string(p->gettitle()).c_str());
+  fprintf(out, ",\"author\":%s", json_string(p->getauthor()).c_str());
+  fprintf(out, ",\"description\":%s", json_string(p->getdesc()).c_str());
+
+  fputs(",\"instruments\":[", out);
+  for(i = 0; i < p->getinstruments(); i++)
+    fprintf(out, "%s%s", i ? "," : "",
+	    json_string(p->getinstrument(i)).c_str());
+
+  fprintf(out, "],\"subsongs\":%u", p->getsubsongs());
+#ifdef HAVE_ADPLUG_GETSUBSONG
+  fprintf(out, ",\"subsong\":%u", p->getsubsong());
+#endif
+
+  if(lengths) {		// in milliseconds
+    fputs(",\"lengths\":[", out);
+    for(i = 0; i < p->getsubsongs(); i++)
+      fprintf(out, "%s%lu", i ? "," : "", p->songlength(i));
+    putc(']', out);
+  }
+
+  delete p;
+}
+
+static void compare(unsigned int item, FILE *out)
+/*
+ * Render file number 'item' with both emulators of --compare and print
+ * how their output differs.
+ */
+{
+  const char	*fn = probe_files[item];
+  MmapProvider	fp(fn);
+  Copl		*a = emu_create(compare_emus[0], cfg.freq, 16, cfg.channels,
+				cfg.harmonic),
+		*b = emu_create(compare_emus[1], cfg.freq, 16, cfg.channels,
+				cfg.harmonic);
+  EmuCompare	cmp(a, b, cfg.freq, cfg.channels);
+  CPlayer	*p = load(fn, cmp.get_opl(), fp);
+
+  if(p) {
+    if(cfg.subsong != (unsigned int)-1 && cfg.subsong != ALL_SUBSONGS)
+      p->rewind(cfg.subsong);
+    cmp.run(p, COMPARE_MAXLEN * cfg.freq);
+    cmp.report(out, fn, emu_name(compare_emus[0]), emu_name(compare_emus[1]));
+    delete p;
+  } else
+    message(MSG_WARN, "unknown filetype -- %s", fn);
+
+  delete a;
+  delete b;
+}
+
+static void probe(unsigned int item, FILE *out)
+/* Print the information on file number 'item' as JSON object line. */
+{
+  fprintf(out, "{\"file\":%s", json_string(probe_files[item]).c_str());
+  describe(probe_files[item], false, out);
+  fputs("}\n", out);
+}
+
+static bool cache_key(const MmapProvider &fp, int subsong, std::string &key)
+/*
+ * Compute the render cache key of playing subsong 'subsong' of the song
+ * loaded through 'fp' with the current configuration into 'key'. The
+ * database is part of the key, as its records change how songs play.
+ */
+{
+  char params[256];
+
+  snprintf(params, sizeof(params),
+	   "%s %d %d %d %d %d %u %d %d %g %d %d %g %s %llx",
+	   emu_name(cfg.emutype), cfg.freq, cfg.bits, cfg.channels,
+	   cfg.harmonic, subsong, cfg.loops, cfg.buf_size, cfg.detectloops,
+	   cfg.silence, cfg.trim, cfg.skipidle == 1, cfg.fade,
+	   CAdPlug::get_version().c_str(),
+	   (unsigned long long)dbcache.signature());
+  return cache->getkey(fp, params, key);
+}
+
+static void play_pcm(EmuPlayer *pl, FILE *f)
+/* Send the PCM data in 'f' to 'pl', from its start. */
+{
+  char		buf[16384];
+  size_t	n;
+
+  rewind(f);
+  while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    pl->outputpcm(buf, n);
+}
+
+static void report_loudness(const char *fn, EmuPlayer *pl, double lufs,
+			    double peak, bool measured)
+/*
+ * Report the loudness 'lufs' and true peak 'peak' of file 'fn' and tag the
+ * output of 'pl' with the ReplayGain of all songs in it, if 'measured'
+ * into 'loudness' and not normalized.
+ */
+{
+  char buf[64];
+
+  message(MSG_NOTE, "loudness %.1f LUFS, true peak %.1f dBTP, ReplayGain "
+	  "%+.2f dB -- %s", lufs, 20 * log10(peak), replaygain(lufs), fn);
+  if(!measured) return;
+
+  totalloudness->merge(*loudness);
+  if(cfg.loudness == 2 || totalloudness->integrated() == -HUGE_VAL) return;
+  snprintf(buf, sizeof(buf), "%+.2f dB",
+	   replaygain(totalloudness->integrated()));
+  pl->settag("REPLAYGAIN_TRACK_GAIN", buf);
+  snprintf(buf, sizeof(buf), "%.6f", totalloudness->truepeak());
+  pl->settag("REPLAYGAIN_TRACK_PEAK", buf);
+  snprintf(buf, sizeof(buf), "%.2f LUFS", REPLAYGAIN_REFERENCE);
+  pl->settag("REPLAYGAIN_REFERENCE_LOUDNESS", buf);
+}
+
+static std::string loudness_info()
+/* The measured loudness, as kept in the render cache. */
+{
+  char buf[64];
+
+  snprintf(buf, sizeof(buf), "%.2f %.6f", loudness->integrated(),
+	   loudness->truepeak());
+  return buf;
+}
+
+static void play_normalized(EmuPlayer *pl, FILE *f, double lufs, double peak)
+/*
+ * Send the PCM data in 'f', of loudness 'lufs' and true peak 'peak', to
+ * 'pl' at its ReplayGain, but no louder than full scale at the peak.
+ */
+{
+  double gain = 0;
+
+  if(lufs != -HUGE_VAL) gain = MIN(replaygain(lufs), -20 * log10(peak));
+  message(MSG_DEBUG, "normalizing by %+.2f dB", gain);
+
+  pl->setloudness(0);
+  pl->setgain(pow(10, gain / 20));
+  play_pcm(pl, f);
+  pl->setgain(1);
+}
+
+static bool play_cached(const char *fn, EmuPlayer *pl, const std::string &key)
+/*
+ * Send the cached render of 'key' to 'pl'. Returns false on a miss. To
+ * normalize it, its loudness is taken from the cache, or measured first.
+ */
+{
+  FILE		*f = cache->lookup(key);
+  std::string	info;
+  double	lufs, peak;
+  bool		known;
+
+  if(!f) return false;
+  message(MSG_DEBUG, "playing from render cache -- %s", key.c_str());
+
+  known = cfg.loudness == 2 && cache->getinfo(key, info) &&
+    sscanf(info.c_str(), "%lf %lf", &lufs, &peak) == 2;
+  if(!known) {
+    pl->setdiscard(cfg.loudness == 2);
+    play_pcm(pl, f);
+    pl->setdiscard(false);
+    if(loudness) {
+      lufs = loudness->integrated(); peak = loudness->truepeak();
+      cache->putinfo(key, loudness_info());
+    }
+  }
+
+  if(cfg.loudness == 2) play_normalized(pl, f, lufs, peak);
+  fclose(f);
+  if(cfg.loudness) report_loudness(fn, pl, lufs, peak, !known);
+  return true;
+}
+
+static unsigned long loop_ticks(const char *fn, Copl::ChipType type,
+				int subsong, const MmapProvider &fp)
+/*
+ * Return the number of ticks of subsong 'subsong' of file 'fn' that play
+ * the song's loop the configured number of times, or 0 if no loop is
+ * found. The song is run by a second, silent instance of its player,
+ * which sees a chip of type 'type'.
+ */
+{
+  CSilentopl	silent;
+  ShadowOpl	shadow(&silent, type);
+  CPlayer	*p = load(fn, &shadow, fp);
+  unsigned long	ticks;
+
+  if(!p) return 0;
+  if(subsong != -1) p->rewind(subsong);
+  ticks = loop_end(p, &shadow, cfg.loops, fn);
+  delete p;
+  return ticks;
+}
+
+static unsigned long fade_ticks(const char *fn, Player *pl, int subsong,
+				const MmapProvider &fp, unsigned long limit)
+/*
+ * Set up the fade out of subsong 'subsong' of file 'fn' on player 'pl',
+ * which ends after 'limit' ticks, or at the song end of the player that
+ * completes the configured number of loops if 'limit' is 0. Returns the
+ * number of ticks to play, or 'limit' if the song's end is not found. The
+ * tick timing is taken from a second, silent instance of the song's player.
+ */
+{
+  CSilentopl	silent;
+  ShadowOpl	shadow(&silent, pl->get_opl()->gettype());
+  CPlayer	*p = load(fn, &shadow, fp);
+  unsigned long	end, tick;
+  double	len;
+
+  if(!p) return limit;
+  if(subsong != -1) p->rewind(subsong);
+  end = fade_end(p, cfg.loops, cfg.fade, limit, tick, len, fn);
+  delete p;
+
+  if(len > 0)
+    ((EmuPlayer *)pl)->setfade(tick, (unsigned long)(len * cfg.freq));
+  return end;
+}
+
+static void seek(CPlayer *p, int subsong, unsigned long ms)
+/*
+ * Restart subsong 'subsong' with player 'p' and run it up to 'ms'
+ * milliseconds into the song, without rendering.
+ */
+{
+  double t = 0;
+
+  p->rewind(subsong);
+  while(t < ms && p->update()) t += 1000 / p->getrefresh();
+}
+
+static bool control_song(Player *pl, int &subsong, bool &complete)
+/*
+ * Carry out the commands received for the song played by 'pl', which is
+ * at subsong 'subsong'. While paused, wait for commands without
+ * rendering. Returns false if the song is to end, with the command that
+ * ends it in 'control_end'. Clears 'complete' once the song is not played
+ * straight through anymore.
+ */
+{
+  ControlChannel::Command	c;
+  long				arg;
+  bool				paused = false;
+
+  do {
+    while((c = control->poll(arg)) != ControlChannel::None)
+      switch(c) {
+      case ControlChannel::Pause:
+	paused = !paused;
+	if(paused) pl->flush();
+	break;
+      case ControlChannel::Seek:
+	seek(pl->p, subsong, arg);
+	pl->flush();
+	complete = false;
+	break;
+      case ControlChannel::Subsong:
+	if(arg < 0 || arg >= (long)pl->p->getsubsongs()) {
+	  message(MSG_WARN, "no such subsong -- %ld", arg);
+	  break;
+	}
+	pl->p->rewind(subsong = arg);
+	pl->flush();
+	complete = false;
+	break;
+      case ControlChannel::Mute:
+	if(muteopl) muteopl->mute(arg - 1, !muteopl->muted(arg - 1));
+	break;
+      default:		// ends the song
+	control_end = c;
+	pl->flush();
+	complete = false;
+	return false;
+      }
+
+    if(paused) control->wait(CONTROL_WAIT);
+  } while(paused && !interrupted);
+
+  return true;
+}
+
+static void play(const char *fn, Player *pl, int subsong = -1,
+		 const MmapProvider *fp = 0)
 /*
  * Start playback of subsong 'subsong' of file 'fn', using player
  * 'player'. If 'subsong' is not given or -1, start playback of
- * default subsong of file.
+ * default subsong of file. The file is read through 'fp', if given.
  */
 {
+  MmapProvider own(fn);
   unsigned long i;
   unsigned long s = 0;
   unsigned long ls = 0;
   unsigned int loops = 0;
+  unsigned long limit = 0;
+  EmuPlayer *emu = dynamic_cast<EmuPlayer *>(pl);
+  EmuPlayer *ep = cache && !cfg.endless && !control ? emu : 0;
+  Copl *chip = emu ? frontopl : pl->get_opl();
+  FILE *capture = 0;
+  bool stored = false, complete = true;
+  bool normalize = emu && cfg.loudness == 2;
+  std::string key;
 
   // initialize output & player
-  pl->get_opl()->init();
+  chip->init();
   delete pl->p;
   pl->reset();
-  pl->p = CAdPlug::factory(fn,pl->get_opl());
+  pl->p = load(fn, chip, fp ? *fp : own);
 
   if(!pl->p) {
     message(MSG_WARN, "unknown filetype -- %s", fn);
@@ -394,7 +989,60 @@ static void play(const char *fn, Player *pl, int subsong = -1)
   if(cfg.songmessage)	// display song message
     fprintf(stderr, "Song message:\n%s\n\n", pl->p->getdesc().c_str());
 
+  if(emu && loudness) {
+    loudness->reset();
+    emu->setloudness(loudness);
+  }
+
+  // serve from the render cache or populate it. Endless playback is
+  // never cached, as it has no end.
+  if(ep && cache_key(fp ? *fp : own, subsong, key)) {
+    if(play_cached(fn, ep, key)) return;
+    if((capture = cache->store(key))) ep->setcapture(capture);
+    stored = capture != 0;
+  }
+
+  // to normalize, render to the cache or a temporary file first
+  if(normalize && !capture && !(capture = tmpfile())) {
+    message(MSG_WARN, "cannot create temporary file, not normalizing -- %s",
+	    fn);
+    normalize = false;
+  }
+  if(normalize) {
+    emu->setcapture(capture);
+    emu->setdiscard(true);
+  }
+
+  // end exactly after the song's loop has been played the configured
+  // number of times
+  if(cfg.detectloops && emu && !cfg.endless)
+    limit = loop_ticks(fn, pl->get_opl()->gettype(), subsong,
+		       fp ? *fp : own);
+
+  // fade out over the end of the last loop and stop right after
+  if(cfg.fade > 0 && emu && !cfg.endless)
+    limit = fade_ticks(fn, pl, subsong, fp ? *fp : own, limit);
+
+  if(limit) emu->setticklimit(limit);
+
+  if(emu && silence) {
+    silence->reset();
+    emu->setsilence(silence);
+  }
+
+  if(emu && idletracker) {
+    idletracker->skipped = idletracker->wrong = idletracker->differed = 0;
+    idletracker->peak = 0;
+    emu->setidle(idletracker, verifyopl);
+  }
+
+  if(cfg.stats) {
+    filestats.reset();
+    if(emu) emu->setstats(&filestats);
+  }
+
   // play loop
+  rendering = 1;
   do {
     if(cfg.songinfo)	// display song info
       fprintf(stderr, "Subsong: %d/%d, Order: %d/%d, Pattern: %d/%d, Row: %d, "
@@ -403,7 +1051,9 @@ static void play(const char *fn, Player *pl, int subsong = -1)
 	      pl->p->getorders(), pl->p->getpattern(), pl->p->getpatterns(),
 	      pl->p->getrow(), pl->p->getspeed(), pl->p->getrefresh());
 
+    if(control && !control_song(pl, subsong, complete)) break;
     pl->frame();
+    if(cfg.rtprio) rt_measure();
     ++s;
 
     if (!pl->playing) {
@@ -413,14 +1063,79 @@ static void play(const char *fn, Player *pl, int subsong = -1)
         s = 0;
       }
     }
-  } while(cfg.endless || loops < cfg.loops);
+  } while(!interrupted && !(emu && emu->silenced()) &&
+	  (cfg.endless || (limit ? pl->playing : loops < cfg.loops)));
+  rendering = 0;
+  if(interrupted) complete = false;
+
+  if(normalize && complete) {
+    emu->setcapture(0);
+    emu->setdiscard(false);
+    play_normalized(emu, capture, loudness->integrated(),
+		    loudness->truepeak());
+  }
+
+  if(stored) {
+    ep->setcapture(0);
+    cache->commit(key, capture, complete);
+    if(loudness) cache->putinfo(key, loudness_info());
+  } else if(capture)
+    fclose(capture);
+
+  if(emu && loudness) {
+    emu->setloudness(0);
+    report_loudness(fn, emu, loudness->integrated(), loudness->truepeak(),
+		    true);
+  }
+
+  if(emu && idletracker) {
+    double idle = (double)idletracker->skipped / cfg.freq;
+
+    if(cfg.skipidle == 1)
+      message(MSG_DEBUG, "skipped emulation of %.1f s -- %s", idle, fn);
+    else {
+      if(idletracker->wrong)
+	message(MSG_WARN, "%.2f s of %.1f s taken as idle were not silent "
+		"-- %s", (double)idletracker->wrong / cfg.freq, idle, fn);
+      else
+	message(MSG_NOTE, "%.1f s taken as idle were silent -- %s", idle, fn);
+      if(idletracker->differed)
+	message(MSG_NOTE, "%.2f s after skipping differed from full "
+		"emulation, by up to %.1f dB -- %s",
+		(double)idletracker->differed / cfg.freq,
+		20 * log10(idletracker->peak), fn);
+    }
+  }
+
+  if(cfg.stats) {
+    if(emu) emu->setstats(0);
+    filestats.report(stderr, (std::string("Timing statistics for '") + fn +
+			      "'").c_str());
+    totalstats.merge(filestats);
+    statfiles++;
+  }
+
+  if(cfg.rtprio) rt_report();
 }
 
 static void shutdown(void)
 /* General deinitialization handler. */
 {
+  if(cfg.rtprio) rt_report();
+  if(statfiles > 1) totalstats.report(stderr, "Timing statistics for all files");
+  if(loaders.files)
+    message(cfg.stats ? MSG_NOTE : MSG_DEBUG,
+	    "%lu loader probes for %lu files", loaders.probes, loaders.files);
   if(player) delete player;
+  if(keytracker) delete keytracker;
+  if(idletracker) delete idletracker;
+  if(verifytee) delete verifytee;
+  if(verifyopl) delete verifyopl;
+  if(silence) delete silence;
+  if(muteopl) delete muteopl;
+  if(control) delete control;
   if(opl) delete opl;
+  if(cache) delete cache;
 }
 
 static void sighandler(int signal)
@@ -431,199 +1146,414 @@ static void sighandler(int signal)
     // Try to properly reposition terminal cursor, if Ctrl+C is used to exit.
     printf("\n\n");
   case SIGTERM:
+    // Let the render loop end the song properly, unless it isn't running
+    // or doesn't react
+    if(rendering && !interrupted) {
+      interrupted = 1;
+      return;
+    }
     exit(EXIT_SUCCESS);
   }
 }
 
-/***** Main program *****/
-
-int main(int argc, char **argv)
+static Player *make_player(const char *device)
+/* Construct the configured output method, writing to 'device'. */
 {
-  int			optind, i;
-  const char		*homedir;
-  char			*userdb = NULL;
-
-  // init
-  program_name = argv[0];
-  atexit(shutdown);
-  signal(SIGINT, sighandler); signal(SIGTERM, sighandler);
-
-  // Try user's home directory first, before trying the default location.
-  homedir = getenv("HOME");
-  if(homedir) {
-    userdb = (char *)malloc(strlen(homedir) + strlen(ADPLUG_CONFDIR) +
-			    strlen(ADPLUGDB_FILE) + 3);
-    strcpy(userdb, homedir); strcat(userdb, "/" ADPLUG_CONFDIR "/");
-    strcat(userdb, ADPLUGDB_FILE);
-  }
-
-  // parse commandline
-  optind = decode_switches(argc,argv);
-  if(optind == argc) {	// no filename given
-    fprintf(stderr, "%s: need at least one file for playback\n", program_name);
-    fprintf(stderr, "Try '%s --help' for more information.\n", program_name);
-    if(userdb) free(userdb);
-    exit(EXIT_FAILURE);
-  }
-  if(argc - optind > 1) cfg.endless = false;	// more than 1 file given
-
-  // init emulator
-  switch(cfg.emutype) {
-  case Emu_Satoh:
-  	if (cfg.harmonic) {
-#ifdef HAVE_ADPLUG_SURROUND
-      COPLprops a, b;
-      a.use16bit = b.use16bit = cfg.bits == 16;
-      a.stereo = b.stereo = false;
-      a.opl = new CEmuopl(cfg.freq, a.use16bit, a.stereo);
-      b.opl = new CEmuopl(cfg.freq, b.use16bit, b.stereo);
-      opl = new CSurroundopl(&a, &b, cfg.bits == 16);
-      // CSurroundopl now owns a.opl and b.opl and will free upon destruction
-#else
-      fprintf(stderr, "Surround requires AdPlug v2.2 or newer.  Use --mono "
-      	"or upgrade and recompile AdPlay.\n");
-      if(userdb) free(userdb);
-      exit(EXIT_FAILURE);
-#endif
-  	} else {
-      opl = new CEmuopl(cfg.freq, cfg.bits == 16, cfg.channels == 2);
-  	}
-    break;
-  case Emu_Ken:
-  	if (cfg.harmonic) {
-#ifdef HAVE_ADPLUG_SURROUND
-#ifndef CKEMUOPL_MULTIINSTANCE
-	  fprintf(stderr, "%s: Sorry, Ken's emulator only supports one instance "
-	    "so does not work properly in surround mode in old versions of "
-	    "the adplug library.\n", program_name);
-#endif
-      COPLprops a, b;
-      a.use16bit = b.use16bit = cfg.bits == 16;
-      a.stereo = b.stereo = false;
-      a.opl = new CKemuopl(cfg.freq, a.use16bit, a.stereo);
-      b.opl = new CKemuopl(cfg.freq, b.use16bit, b.stereo);
-      opl = new CSurroundopl(&a, &b, cfg.bits == 16);
-      // CSurroundopl now owns a and b and will free upon destruction
-#else
-      fprintf(stderr, "Surround requires AdPlug v2.2 or newer.  Use --mono "
-      	"or upgrade and recompile AdPlay.\n");
-      if(userdb) free(userdb);
-      exit(EXIT_FAILURE);
-#endif
-  	} else {
-  		opl = new CKemuopl(cfg.freq, cfg.bits == 16, cfg.channels == 2);
-  	}
-    break;
-   case Emu_Woody:
-  	if (cfg.harmonic) {
-#ifdef HAVE_ADPLUG_SURROUND
-      COPLprops a, b;
-      a.use16bit = b.use16bit = cfg.bits == 16;
-      a.stereo = b.stereo = false;
-      a.opl = new CWemuopl(cfg.freq, a.use16bit, a.stereo);
-      b.opl = new CWemuopl(cfg.freq, b.use16bit, b.stereo);
-      opl = new CSurroundopl(&a, &b, cfg.bits == 16);
-      // CSurroundopl now owns a and b and will free upon destruction
-#else
-      fprintf(stderr, "Surround requires AdPlug v2.2 or newer.  Use --mono "
-      	"or upgrade and recompile AdPlay.\n");
-      if(userdb) free(userdb);
-      exit(EXIT_FAILURE);
-#endif
-  	} else {
-      opl = new CWemuopl(cfg.freq, cfg.bits == 16, cfg.channels == 2);
-  	}
-    break;
-#ifdef HAVE_ADPLUG_NUKEDOPL
-  case Emu_Nuked:
-    if (cfg.harmonic) {
-      COPLprops a, b;
-      a.use16bit = b.use16bit = true; // Nuked only supports 16-bit
-      a.stereo = b.stereo = true; // Nuked only supports stereo
-      a.opl = new CNemuopl(cfg.freq);
-      b.opl = new CNemuopl(cfg.freq);
-      opl = new CSurroundopl(&a, &b, cfg.bits == 16); // SurroundOPL can convert to 8-bit though
-      // CSurroundopl now owns a and b and will free upon destruction
-  	} else {
-  		if(cfg.bits != 16 || cfg.channels != 2) {
-  			fprintf(stderr, "Sorry, Nuked OPL3 emulator only works in stereo 16 bits. "
-  				"Use --stereo and --16bit options.\n");
-  			if(userdb) free(userdb);
-  			exit(EXIT_FAILURE);
-  		} else {
-  			opl = new CNemuopl(cfg.freq);
-  		}
-  	}
-  	break;
-#endif
-  }
-
-  // init player
   switch(cfg.output) {
   case none:
     message(MSG_PANIC, "no output methods compiled in");
     exit(EXIT_FAILURE);
 #ifdef DRIVER_OSS
   case oss:
-    player = new OSSPlayer(opl, cfg.device, cfg.bits, cfg.channels, cfg.freq,
-			   cfg.buf_size);
-    break;
+    return new OSSPlayer(opl, device, cfg.bits, cfg.channels, cfg.freq,
+			 cfg.buf_size);
 #endif
 #ifdef DRIVER_NULL
   case null:
-    player = new NullOutput();
-    break;
+    return new NullOutput();
 #endif
 #ifdef DRIVER_DISK
   case disk:
-    player = new DiskWriter(opl, cfg.device, cfg.bits, cfg.channels, cfg.freq);
-    break;
+    return new DiskWriter(opl, device, cfg.bits, cfg.channels, cfg.freq);
 #endif
 #ifdef DRIVER_ESOUND
   case esound:
-    player = new EsoundPlayer(opl, cfg.bits, cfg.channels, cfg.freq,
-			      cfg.device);
-    break;
+    return new EsoundPlayer(opl, cfg.bits, cfg.channels, cfg.freq, device);
 #endif
 #ifdef DRIVER_QSA
   case qsa:
-    player = new QSAPlayer(opl, cfg.bits, cfg.channels, cfg.freq);
-    break;
+    return new QSAPlayer(opl, cfg.bits, cfg.channels, cfg.freq);
 #endif
 #ifdef DRIVER_AO
   case ao:
-    player = new AOPlayer(opl, cfg.device, cfg.bits, cfg.channels, cfg.freq, cfg.buf_size);
-    break;
+    return new AOPlayer(opl, device, cfg.bits, cfg.channels, cfg.freq, cfg.buf_size);
 #endif
 #ifdef DRIVER_SDL
   case sdl:
-    player = new SDLPlayer(opl, cfg.bits, cfg.channels, cfg.freq, cfg.buf_size);
-    break;
+    return new SDLPlayer(opl, cfg.bits, cfg.channels, cfg.freq, cfg.buf_size);
 #endif
 #ifdef DRIVER_ALSA
   case alsa:
-    player = new ALSAPlayer(opl, cfg.device, cfg.bits, cfg.channels, cfg.freq,
-			    cfg.buf_size);
-    break;
+    return new ALSAPlayer(opl, device, cfg.bits, cfg.channels, cfg.freq,
+			  cfg.buf_size, cfg.powersave * cfg.freq);
+#endif
+#ifdef DRIVER_HTTP
+  case http:
+    return new HTTPStreamer(opl, device, cfg.bits, cfg.channels, cfg.freq);
 #endif
 #ifdef DRIVER_RAW
   case raw:
-    player = new DiskRawWriter(new CDiskopl(cfg.device));
-    break;
+    return new DiskRawWriter(new CDiskopl(device));
+#endif
+#ifdef DRIVER_HASH
+  case hash:
+    return new HashSink(opl, device, cfg.bits, cfg.channels, cfg.freq);
 #endif
   default:
     message(MSG_ERROR, "output method not available");
     exit(EXIT_FAILURE);
   }
+}
+
+static bool file_output()
+/* True if the configured output method writes to a file. */
+{
+#ifdef DRIVER_DISK
+  if(cfg.output == disk) return true;
+#endif
+#ifdef DRIVER_RAW
+  if(cfg.output == raw) return true;
+#endif
+  return false;
+}
 
-  // load database
-  if(userdb) { mydb.load(userdb); free(userdb); }
-  mydb.load(ADPLUGDB_PATH);
+static bool subsong_files()
+/*
+ * Whether all subsongs go to numbered files of their own. Standard output
+ * has no name to number, so subsongs follow each other there.
+ */
+{
+  return cfg.subsong == ALL_SUBSONGS && file_output() &&
+    !(cfg.device && !strcmp(cfg.device, "-"));
+}
+
+static std::string suffixed(const char *fn, const std::string &suffix)
+/*
+ * Return file name 'fn' with 'suffix' inserted before its extension, e.g.
+ * "song-ch3.wav".
+ */
+{
+  std::string			name(fn);
+  std::string::size_type	ext = name.find_last_of('.');
+
+  if(ext == std::string::npos ||
+     name.find('/', ext) != std::string::npos) ext = name.size();
+  return name.insert(ext, "-" + suffix);
+}
+
+static std::string numbered(const char *fn, unsigned int n, unsigned int count)
+/*
+ * Return file name 'fn' with number 'n' out of 'count' inserted before
+ * its extension, e.g. "song-07.wav".
+ */
+{
+  char	num[32];
+  int	width = 2;
+
+  for(; count > 100; count /= 10) width++;
+  snprintf(num, sizeof(num), "%0*u", width, n);
+  return suffixed(fn, num);
+}
+
+static const char		*subsongs_file;
+static const MmapProvider	*subsongs_fp;
+static unsigned int		subsongs_count;
+
+static void render_subsong(unsigned int item, FILE *out)
+/* Render subsong number 'item' of 'subsongs_file' to its numbered file. */
+{
+  std::string	fn = numbered(cfg.device, item, subsongs_count);
+  Player	*pl = make_player(fn.c_str());
+  Copl		*rawopl = 0;
+
+#ifdef DRIVER_RAW
+  if(cfg.output == raw) rawopl = pl->get_opl();
+#endif
+
+  play(subsongs_file, pl, item, subsongs_fp);
+
+  // Finish the file, which exiting the worker wouldn't do
+  delete pl;
+  delete rawopl;
+}
+
+static void play_subsongs(const char *fn)
+/*
+ * Play all subsongs of file 'fn' one after another. Subsongs are rendered
+ * in parallel into numbered files with file output methods, unless those
+ * write to standard output. The file is only read once, workers load
+ * their player from memory.
+ */
+{
+  MmapProvider	fp(fn);
+  CSilentopl	silent;
+  CPlayer	*p = load(fn, &silent, fp);
+  unsigned int	i, count;
+
+  if(!p) {
+    message(MSG_WARN, "unknown filetype -- %s", fn);
+    return;
+  }
+
+  count = p->getsubsongs();
+  delete p;
+
+  if(subsong_files()) {
+    if(!cfg.device) {
+      message(MSG_ERROR, "no output filename specified");
+      exit(EXIT_FAILURE);
+    }
+
+    subsongs_file = fn; subsongs_fp = &fp; subsongs_count = count;
+    run_parallel(count, cfg.jobs, render_subsong, stdout);
+  } else
+    for(i = 0; i < count && !interrupted && control_end != ControlChannel::Quit;
+	i++)
+      play(fn, player, i, &fp);
+}
+
+static const StemLog		*stems_log;
+static std::vector<int>		stems_used;
+
+static void render_stem(unsigned int item, FILE *out)
+/* Render stem number 'item' of 'stems_used' to its own file. */
+{
+  int		stem = stems_used[item];
+  std::string	fn = suffixed(cfg.device, StemLog::name(stem));
+  Player	*pl = make_player(fn.c_str());
+  EmuPlayer	*emu = dynamic_cast<EmuPlayer *>(pl);
+
+  if(!emu) {
+    message(MSG_ERROR, "output method can't write stems");
+    exit(EXIT_FAILURE);
+  }
+
+  stems_log->render(stem, emu->get_opl(), *emu,
+		    cfg.channels * (cfg.bits / 8));
+  delete pl;		// finish the file, which exiting wouldn't do
+}
+
+static void play_stems(const char *fn)
+/*
+ * Render each channel of file 'fn' that plays any note into its own
+ * file. The player runs only once, while its register writes are
+ * recorded. These are then rendered in parallel, each with all but one
+ * channel muted.
+ */
+{
+  MmapProvider	fp(fn);
+  StemLog	log(opl->gettype());
+  CPlayer	*p = load(fn, &log, fp);
+  unsigned long	limit = 0;
+  int		subsong = (int)cfg.subsong;
+
+  if(!p) {
+    message(MSG_WARN, "unknown filetype -- %s", fn);
+    return;
+  }
+
+  if(subsong != -1) p->rewind(subsong);
+  if(cfg.detectloops)
+    limit = loop_ticks(fn, opl->gettype(), subsong, fp);
+  log.run(p, cfg.freq, limit, cfg.loops, STEMS_MAXLEN * cfg.freq);
+  delete p;
+
+  stems_log = &log;
+  stems_used = log.used();
+  message(MSG_NOTE, "rendering %u stems -- %s", (unsigned)stems_used.size(),
+	  fn);
+  run_parallel(stems_used.size(), cfg.jobs, render_stem, stdout);
+}
+
+/***** Main program *****/
+
+int main(int argc, char **argv)
+{
+  int			optind, i;
+  const char		*homedir;
+  char			*userdb = NULL;
+  struct stat		st;
+  Playlist		playlist(READAHEAD_FILES);
+  std::string		fn;
+  bool			several;
+
+  // init
+  program_name = argv[0];
+  atexit(shutdown);
+  signal(SIGINT, sighandler); signal(SIGTERM, sighandler);
+
+  // Try user's home directory first, before trying the default location.
+  homedir = getenv("HOME");
+  if(homedir) {
+    userdb = (char *)malloc(strlen(homedir) + strlen(ADPLUG_CONFDIR) +
+			    strlen(ADPLUGDB_FILE) + 3);
+    strcpy(userdb, homedir); strcat(userdb, "/" ADPLUG_CONFDIR "/");
+    strcat(userdb, ADPLUGDB_FILE);
+  }
+
+  // parse commandline
+  optind = decode_switches(argc,argv);
+  if(optind == argc && !cfg.daemon && !cfg.filesfrom) { // no filename given
+    fprintf(stderr, "%s: need at least one file for playback\n", program_name);
+    fprintf(stderr, "Try '%s --help' for more information.\n", program_name);
+    if(userdb) free(userdb);
+    exit(EXIT_FAILURE);
+  }
+  several = argc - optind > 1 || cfg.filesfrom ||	// more than 1 file given
+    (optind < argc && (Playlist::isplaylist(argv[optind]) ||
+		       (cfg.recursive && !stat(argv[optind], &st) &&
+			S_ISDIR(st.st_mode))));
+  if(several || cfg.subsong == ALL_SUBSONGS) cfg.endless = false;
+  if(several && subsong_files()) {
+    message(MSG_ERROR, "subsongs are numbered after the output file, which "
+	    "only works for a single song");
+    exit(EXIT_FAILURE);
+  }
+  if(cfg.stems && (!file_output() || !cfg.device || !strcmp(cfg.device, "-") ||
+		   cfg.subsong == ALL_SUBSONGS || several)) {
+    message(MSG_ERROR, "stems need a file output method, a file name, a "
+	    "single song and a single subsong");
+    exit(EXIT_FAILURE);
+  }
+  if(cfg.control && !cfg.controlfifo && cfg.filesfrom &&
+     !strcmp(cfg.filesfrom, "-")) {
+    message(MSG_ERROR, "cannot read both commands and the file list from "
+	    "standard input, use --control=FIFO");
+    exit(EXIT_FAILURE);
+  }
+  if(cfg.loudness == 2 && cfg.endless) {
+    message(MSG_ERROR, "normalizing needs songs to end, use -o or -l");
+    exit(EXIT_FAILURE);
+  }
+  if(!cfg.jobs) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.jobs = cpus > 0 ? cpus : 1;
+  }
+
+  // set up database, which is compiled into the user's configuration
+  // directory and loaded on demand
+  if(userdb) {
+    std::string confdir = std::string(homedir) + "/" ADPLUG_CONFDIR;
+
+    dbcache.addsource(userdb);
+    free(userdb);
+    dbcache.setcache(confdir + "/" ADPLUGDB_CACHE);
+  }
+  dbcache.addsource(ADPLUGDB_PATH);
   CAdPlug::set_database(&mydb);
 
-  // play all files from commandline
-  for(i=optind;i<argc;i++)
-    play(argv[i],player,cfg.subsong);
+  // probe files in parallel, without playing them
+  if(cfg.probe) {
+    probe_files = argv + optind;
+    dbcache.open();	// compile only once, before forking
+    exit(run_parallel(argc - optind, cfg.jobs, probe, stdout) ?
+	 EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  // compare emulators on all files in parallel
+  if(cfg.compare) {
+    for(i = 0; i < 2; i++) {
+      Copl *test = emu_create(compare_emus[i], cfg.freq, 16, cfg.channels,
+			      cfg.harmonic);
+
+      if(!test) exit(EXIT_FAILURE);
+      delete test;
+    }
+    probe_files = argv + optind;
+    dbcache.open();
+    exit(run_parallel(argc - optind, cfg.jobs, compare, stdout) ?
+	 EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  // update song index
+  if(cfg.index) {
+    dbcache.open();
+    exit(update_index(cfg.index, argv + optind, argc - optind, cfg.jobs,
+		      describe) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  // run as render daemon
+  if(cfg.daemon) {
+    RenderRequest defaults;
+
+    defaults.subsong = (int)cfg.subsong;
+    defaults.emutype = cfg.emutype;
+    defaults.freq = cfg.freq; defaults.bits = cfg.bits;
+    defaults.channels = cfg.channels; defaults.harmonic = cfg.harmonic;
+    defaults.start = defaults.length = 0;
+    dbcache.fetchall();
+    exit(run_daemon(cfg.daemon, cfg.jobs, defaults));
+  }
+
+  if(cfg.cache)
+    cache = new RenderCache(cfg.cache,
+			    (unsigned long long)cfg.cache_size << 20);
+
+  // init emulator
+  opl = emu_create(cfg.emutype, cfg.freq, cfg.bits, cfg.channels, cfg.harmonic);
+  if(!opl) exit(EXIT_FAILURE);
+
+  // init the chips that players write to in front of the emulator
+  frontopl = opl;
+  if(cfg.skipidle == 2) {
+    // a second emulator skips the idle time, to compare it to this one
+    verifyopl = emu_create(cfg.emutype, cfg.freq, cfg.bits, cfg.channels,
+			   cfg.harmonic);
+    if(!verifyopl) exit(EXIT_FAILURE);
+    frontopl = verifytee = new TeeOpl(frontopl, verifyopl);
+  }
+  if(cfg.skipidle)
+    frontopl = idletracker = new IdleTracker(frontopl, cfg.freq);
+  if(cfg.silence > 0 || cfg.trim) {
+    silence = new SilenceFilter(cfg.bits, cfg.channels, cfg.freq);
+    silence->setlimit(cfg.silence);
+    silence->settrim(cfg.trim, cfg.trim);
+    frontopl = keytracker = new KeyTracker(frontopl, silence);
+  }
+  if(cfg.control) {
+    control = new ControlChannel(cfg.controlfifo);
+    frontopl = muteopl = new MuteOpl(frontopl);
+  }
+
+  if(cfg.loudness) {
+    loudness = new Loudness(cfg.bits, cfg.channels, cfg.freq);
+    totalloudness = new Loudness(cfg.bits, cfg.channels, cfg.freq);
+  }
+
+  // init player
+  if(!subsong_files() && !cfg.stems)
+    player = make_player(cfg.device);
+
+  // everything is set up, switch to realtime playback
+  if(cfg.rtprio) set_realtime(cfg.rtprio);
+
+  // play all files from commandline, playlists and file lists
+  playlist.setrecursive(cfg.recursive);
+  for(i=optind;i<argc;i++) playlist.add(argv[i]);
+  if(cfg.filesfrom) playlist.addfrom(cfg.filesfrom);
+
+  while(playlist.next(fn)) {
+    control_end = ControlChannel::None;
+    if(cfg.stems)
+      play_stems(fn.c_str());
+    else if(cfg.subsong == ALL_SUBSONGS)
+      play_subsongs(fn.c_str());
+    else
+      play(fn.c_str(),player,cfg.subsong);
+
+    if(interrupted || control_end == ControlChannel::Quit) break;
+    if(control_end == ControlChannel::Prev) playlist.back();
+  }
 
   // deinit
   exit(EXIT_SUCCESS);
@@ -17,14 +17,19 @@
  * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.  
  */
 
+#include <unistd.h>
+
 #include "defines.h"
 #include "alsa.h"
+#include "probes.h"
 
 #define DEFAULT_DEVICE	"default"	// Default ALSA output device
 
 ALSAPlayer::ALSAPlayer(Copl *nopl, const char *device, unsigned char bits,
-		       int channels, int freq, unsigned long bufsize)
-  : EmuPlayer(nopl, bits, channels, freq, bufsize)
+		       int channels, int freq, unsigned long bufsize,
+		       unsigned long nburst)
+  : EmuPlayer(nopl, bits, channels, freq, bufsize), rate(freq),
+    burst(nburst), wakeups(0), written(0)
 {
   snd_pcm_hw_params_t	*hwparams;
   unsigned int		nfreq = freq;
@@ -69,6 +74,7 @@ ALSAPlayer::ALSAPlayer(Copl *nopl, const char *device, unsigned char bits,
   if(nfreq != (unsigned int)freq)
     message(MSG_NOTE, "%d Hz sample rate not supported by your hardware, using "
 	    "%d Hz instead", freq, nfreq);
+  rate = nfreq;
 
   // Set number of channels
   if(snd_pcm_hw_params_set_channels(pcm_handle, hwparams, channels) < 0) {
@@ -76,20 +82,24 @@ ALSAPlayer::ALSAPlayer(Copl *nopl, const char *device, unsigned char bits,
     exit(EXIT_FAILURE);
   }
 
-  // Set number of periods
-  if(snd_pcm_hw_params_set_periods(pcm_handle, hwparams, 4, 0) < 0) {
-    message(MSG_ERROR, "error setting periods");
-    exit(EXIT_FAILURE);
-  }
-
-  // Set the preferred buffer size (in samples)
-  if(snd_pcm_hw_params_set_buffer_size(pcm_handle, hwparams, 4*bufsize / getsampsize()) < 0) {
-    if (snd_pcm_hw_params_get_buffer_size(hwparams, &nbufsize) < 0) {
-      message(MSG_ERROR, "error setting and getting buffer size");
+  if(burst)
+    setpowersave(hwparams);
+  else {
+    // Set number of periods
+    if(snd_pcm_hw_params_set_periods(pcm_handle, hwparams, 4, 0) < 0) {
+      message(MSG_ERROR, "error setting periods");
       exit(EXIT_FAILURE);
-  	}
-    setbufsize(nbufsize);
-    message(MSG_NOTE, "couldn't set buffersize to %ld, using default of %ld instead", bufsize, nbufsize);
+    }
+
+    // Set the preferred buffer size (in samples)
+    if(snd_pcm_hw_params_set_buffer_size(pcm_handle, hwparams, 4*bufsize / getsampsize()) < 0) {
+      if (snd_pcm_hw_params_get_buffer_size(hwparams, &nbufsize) < 0) {
+        message(MSG_ERROR, "error setting and getting buffer size");
+        exit(EXIT_FAILURE);
+    	}
+      setbufsize(nbufsize);
+      message(MSG_NOTE, "couldn't set buffersize to %ld, using default of %ld instead", bufsize, nbufsize);
+    }
   }
 
   // Apply HW parameter settings to PCM device and prepare device
@@ -99,17 +109,91 @@ ALSAPlayer::ALSAPlayer(Copl *nopl, const char *device, unsigned char bits,
   }
 
   snd_pcm_hw_params_free(hwparams);
+
+  if(burst) {
+    snd_pcm_sw_params_t *swparams;
+
+    // Start playback after the first burst and only consider the device
+    // writable once a whole burst fits into the buffer again.
+    snd_pcm_sw_params_malloc(&swparams);
+    if(snd_pcm_sw_params_current(pcm_handle, swparams) < 0 ||
+       snd_pcm_sw_params_set_start_threshold(pcm_handle, swparams, burst) < 0 ||
+       snd_pcm_sw_params_set_avail_min(pcm_handle, swparams, burst) < 0 ||
+       snd_pcm_sw_params(pcm_handle, swparams) < 0)
+      message(MSG_WARN, "error setting SW params for power saving mode");
+    snd_pcm_sw_params_free(swparams);
+  }
 }
 
 ALSAPlayer::~ALSAPlayer()
 {
+  if(burst && written)
+    message(MSG_NOTE, "%lu wakeups in %.1f seconds (%.2f wakeups/s)", wakeups,
+	    (double)written / rate, (double)wakeups * rate / written);
+
   // stop playback immediately
   snd_pcm_drop(pcm_handle);
   snd_pcm_close(pcm_handle);
 }
 
+void ALSAPlayer::flush()
+{
+  snd_pcm_drop(pcm_handle);
+  snd_pcm_prepare(pcm_handle);
+}
+
+void ALSAPlayer::setpowersave(snd_pcm_hw_params_t *hwparams)
+/*
+ * Configure a buffer of two bursts, which is refilled one burst at a
+ * time. Period interrupts are disabled where possible, as output()
+ * sleeps on a timer until the next burst fits instead.
+ */
+{
+  snd_pcm_uframes_t bufframes = 2 * burst, period = burst;
+
+  if(snd_pcm_hw_params_set_buffer_size_near(pcm_handle, hwparams,
+					    &bufframes) < 0 ||
+     snd_pcm_hw_params_set_period_size_near(pcm_handle, hwparams,
+					    &period, 0) < 0) {
+    message(MSG_ERROR, "error setting buffer size for power saving mode");
+    exit(EXIT_FAILURE);
+  }
+
+#ifdef HAVE_SND_PCM_HW_PARAMS_SET_PERIOD_WAKEUP
+  if(!snd_pcm_hw_params_can_disable_period_wakeup(hwparams) ||
+     snd_pcm_hw_params_set_period_wakeup(pcm_handle, hwparams, 0) < 0)
+    message(MSG_NOTE, "cannot disable period wakeups on this device");
+#endif
+
+  if(bufframes / 2 != burst)
+    message(MSG_NOTE, "couldn't set power saving buffer to %lu samples, using "
+	    "%lu instead", 2 * burst, (unsigned long)bufframes);
+
+  burst = bufframes / 2;
+  setbufsize(burst);
+}
+
 void ALSAPlayer::output(const void *buf, unsigned long size)
 {
-  if(snd_pcm_writei(pcm_handle, buf, size / getsampsize()) < 0)
+  snd_pcm_sframes_t frames = size / getsampsize(), avail;
+
+  if(burst) {
+    // Sleep until the whole burst fits, rather than letting a blocking
+    // write wake us up once per period.
+    while((avail = snd_pcm_avail(pcm_handle)) >= 0 && avail < frames) {
+      usleep((useconds_t)((frames - avail) * 1000000.0 / rate));
+      wakeups++;
+    }
+    if(avail < 0) {
+      PROBE_XRUN((int)avail);
+      snd_pcm_recover(pcm_handle, avail, 1);
+    }
+    wakeups++;
+    written += frames;
+  }
+
+  if((avail = snd_pcm_writei(pcm_handle, buf, frames)) < 0) {
+    PROBE_XRUN((int)avail);
     snd_pcm_prepare(pcm_handle);
+  }
 }
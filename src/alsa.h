@@ -30,14 +30,22 @@ class ALSAPlayer: public EmuPlayer
 {
 public:
   ALSAPlayer(Copl *nopl, const char *device, unsigned char bits, int channels,
-	     int freq, unsigned long bufsize);
+	     int freq, unsigned long bufsize, unsigned long nburst = 0);
   virtual ~ALSAPlayer();
 
+  virtual void flush();
+
 protected:
   virtual void output(const void *buf, unsigned long size);
 
 private:
+  void setpowersave(snd_pcm_hw_params_t *hwparams);
+
   snd_pcm_t *pcm_handle;
+  unsigned int rate;
+
+  // Power saving mode: burst size and wakeup statistics (in samples)
+  unsigned long burst, wakeups, written;
 };
 
 #endif
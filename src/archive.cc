@@ -0,0 +1,285 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Only the parts of the zip and tar formats needed to find and read
+ * plain files are supported. Stored zip and tar members are served
+ * straight from the archive without copying. Deflated zip members and
+ * gzipped tar archives need zlib.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <adplug/fprovider.h>
+
+#include "defines.h"
+#include "archive.h"
+
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+#  include <zlib.h>
+#  define HAVE_ZLIB
+#endif
+
+// zip record signatures
+#define ZIP_LOCAL	0x04034b50
+#define ZIP_CENTRAL	0x02014b50
+#define ZIP_END		0x06054b50
+
+// zip compression methods
+#define ZIP_STORED	0
+#define ZIP_DEFLATED	8
+
+#define TAR_BLOCK	512
+
+static unsigned long get16(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned long get32(const unsigned char *p)
+{
+  return get16(p) | (get16(p + 2) << 16);
+}
+
+static unsigned long octal(const unsigned char *p, unsigned int len)
+{
+  unsigned long n = 0;
+
+  for(; len && *p == ' '; len--, p++) ;
+  for(; len && *p >= '0' && *p <= '7'; len--, p++)
+    n = n * 8 + *p - '0';
+  return n;
+}
+
+static std::string field(const unsigned char *p, unsigned int len)
+/* Return the NUL-terminated string of at most 'len' chars at 'p'. */
+{
+  return std::string((const char *)p, strnlen((const char *)p, len));
+}
+
+static bool istgz(const std::string &name)
+{
+  return CFileProvider::extension(name, ".tgz") ||
+    CFileProvider::extension(name, ".tar.gz");
+}
+
+bool Archive::isarchive(const std::string &name)
+{
+  return CFileProvider::extension(name, ".zip") ||
+    CFileProvider::extension(name, ".tar") || istgz(name);
+}
+
+Archive *Archive::create(const std::string &name, const void *data,
+			 unsigned long size)
+{
+  Archive	*a = new Archive(data, size);
+  bool		ok;
+
+  if(CFileProvider::extension(name, ".zip"))
+    ok = a->readzip();
+  else
+    ok = (!istgz(name) || a->gunzip()) && a->readtar();
+
+  if(!ok) {
+    delete a;
+    return 0;
+  }
+
+  message(MSG_DEBUG, "%lu files in archive %s", (unsigned long)a->entries.size(),
+	  name.c_str());
+  return a;
+}
+
+bool Archive::readzip()
+{
+  const unsigned char	*end = base + length, *p = 0;
+  unsigned long		i, n, offset, namelen;
+  Entry			e;
+
+  // The end record is followed by a comment of up to 64k
+  for(i = 22; i <= length && i <= 22 + 0xffff; i++)
+    if(get32(end - i) == ZIP_END) { p = end - i; break; }
+  if(!p) return false;
+
+  n = get16(p + 10);
+  offset = get32(p + 16);
+  if(offset > length) return false;
+
+  for(p = base + offset; n; n--) {
+    if(end - p < 46 || get32(p) != ZIP_CENTRAL) return false;
+    namelen = get16(p + 28);
+    if((unsigned long)(end - p) < 46 + namelen) return false;
+
+    e.method = get16(p + 8) & 1 ? -1 : get16(p + 10);	// encrypted?
+    e.csize = get32(p + 20);
+    e.size = get32(p + 24);
+    offset = get32(p + 42);
+
+    // Member data follows its local header
+    if(length < 30 || offset > length - 30 || get32(base + offset) != ZIP_LOCAL) return false;
+    e.offset = offset + 30 + get16(base + offset + 26) +
+      get16(base + offset + 28);
+    if(e.offset > length || e.csize > length - e.offset) return false;
+
+    if(namelen && p[46 + namelen - 1] != '/')	// skip directories
+      entries[std::string((const char *)p + 46, namelen)] = e;
+
+    p += 46 + namelen + get16(p + 30) + get16(p + 32);
+  }
+
+  return true;
+}
+
+bool Archive::readtar()
+{
+  const unsigned char	*h;
+  unsigned long		pos = 0, sum, i;
+  std::string		name, longname;
+  Entry			e;
+
+  e.method = ZIP_STORED;
+
+  while(pos + TAR_BLOCK <= length && base[pos]) {
+    h = base + pos;
+
+    // Verify the header checksum, which counts itself as blanks
+    for(sum = 8 * ' ', i = 0; i < TAR_BLOCK; i++)
+      if(i < 148 || i >= 156) sum += h[i];
+    if(sum != octal(h + 148, 8)) return false;
+
+    e.offset = pos + TAR_BLOCK;
+    e.size = e.csize = octal(h + 124, 12);
+    if(e.size > length - e.offset) return false;
+
+    if(h[156] == 'L')		// GNU long name of the next member
+      longname = field(base + e.offset, e.size);
+    else {
+      if(h[156] == '0' || !h[156]) {
+	if(!longname.empty())
+	  name = longname;
+	else {
+	  name = field(h, 100);
+	  if(!memcmp(h + 257, "ustar", 5) && h[345])
+	    name = field(h + 345, 155) + "/" + name;
+	}
+
+	if(!name.compare(0, 2, "./")) name.erase(0, 2);
+	entries[name] = e;
+      }
+      longname.clear();
+    }
+
+    pos = e.offset + ((e.size + TAR_BLOCK - 1) & ~(TAR_BLOCK - 1UL));
+  }
+
+  return true;
+}
+
+bool Archive::gunzip()
+/* Decompress a gzipped archive into 'unpacked'. */
+{
+#ifdef HAVE_ZLIB
+  z_stream	z;
+  int		ret;
+
+  memset(&z, 0, sizeof(z));
+  if(inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) return false;
+  z.next_in = (Bytef *)base;
+  z.avail_in = length;
+  unpacked.resize(length * 4 + TAR_BLOCK);
+
+  do {
+    if(z.total_out == unpacked.size()) unpacked.resize(unpacked.size() * 2);
+    z.next_out = &unpacked[z.total_out];
+    z.avail_out = unpacked.size() - z.total_out;
+    ret = inflate(&z, Z_NO_FLUSH);
+  } while(ret == Z_OK);
+
+  unpacked.resize(z.total_out);
+  inflateEnd(&z);
+  if(ret != Z_STREAM_END) return false;
+
+  base = &unpacked[0];
+  length = unpacked.size();
+  return true;
+#else
+  message(MSG_WARN, "compressed archives are not supported");
+  return false;
+#endif
+}
+
+bool Archive::find(const std::string &entry, std::string &found) const
+{
+  std::map<std::string, Entry>::const_iterator i = entries.find(entry);
+
+  if(i == entries.end())
+    for(i = entries.begin(); i != entries.end(); i++)
+      if(!strcasecmp(i->first.c_str(), entry.c_str())) break;
+
+  if(i == entries.end()) return false;
+  found = i->first;
+  return true;
+}
+
+bool Archive::extract(const std::string &entry, void *&data,
+		      unsigned long &size, bool &owned) const
+{
+  std::map<std::string, Entry>::const_iterator i = entries.find(entry);
+
+  if(i == entries.end()) return false;
+  const Entry &e = i->second;
+
+  if(e.method == ZIP_STORED && e.size == e.csize) {
+    data = (void *)(base + e.offset);
+    size = e.size;
+    owned = false;
+    return true;
+  }
+
+#ifdef HAVE_ZLIB
+  if(e.method == ZIP_DEFLATED) {
+    z_stream	z;
+    int		ret;
+
+    memset(&z, 0, sizeof(z));
+    if(inflateInit2(&z, -MAX_WBITS) != Z_OK) return false;
+    data = new char [e.size + 1];
+    z.next_in = (Bytef *)(base + e.offset);
+    z.avail_in = e.csize;
+    z.next_out = (Bytef *)data;
+    z.avail_out = e.size + 1;		// room to notice excess data
+    ret = inflate(&z, Z_FINISH);
+    inflateEnd(&z);
+
+    if(ret == Z_STREAM_END && z.total_out == e.size) {
+      size = e.size;
+      owned = true;
+      return true;
+    }
+
+    delete [] (char *)data;
+    message(MSG_WARN, "corrupt archive member -- %s", entry.c_str());
+    return false;
+  }
+#endif
+
+  message(MSG_WARN, "unsupported compression method of archive member -- %s",
+	  entry.c_str());
+  return false;
+}
@@ -0,0 +1,74 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * archive.h - Read access to the members of zip and tar archives in
+ * memory.
+ */
+
+#ifndef H_ARCHIVE
+#define H_ARCHIVE
+
+#include <string>
+#include <vector>
+#include <map>
+
+class Archive
+{
+public:
+  // Read the archive 'name', whose contents are in 'data'. The format is
+  // chosen by the file name extension. Returns 0 if the archive can't be
+  // read. 'data' must stay valid for the lifetime of the archive.
+  static Archive *create(const std::string &name, const void *data,
+			 unsigned long size);
+
+  // Find 'entry' in the archive, ignoring case if there is no exact
+  // match. Sets 'found' to the name as stored in the archive.
+  bool find(const std::string &entry, std::string &found) const;
+
+  // Return the contents of 'entry' in 'data'. If 'owned' is set, 'data'
+  // was allocated with new[] and is now owned by the caller. Otherwise,
+  // it points into the archive.
+  bool extract(const std::string &entry, void *&data, unsigned long &size,
+	       bool &owned) const;
+
+  // True if 'name' has a file name extension of a supported archive
+  static bool isarchive(const std::string &name);
+
+private:
+  struct Entry {
+    unsigned long	offset, size, csize;
+    int			method;		// zip compression method
+  };
+
+  Archive(const void *ndata, unsigned long nsize)
+    : base((const unsigned char *)ndata), length(nsize)
+  { }
+
+  bool readzip();
+  bool readtar();
+  bool gunzip();
+
+  const unsigned char			*base;
+  unsigned long				length;
+  std::vector<unsigned char>		unpacked;	// of compressed tar
+  std::map<std::string, Entry>		entries;
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Each cached render is a file of raw PCM data, named after its key. New
+ * renders are written to a temporary file and renamed when complete, so
+ * concurrent adplay processes never see partial renders. The cache is
+ * kept below its size limit by removing the least recently used renders,
+ * which is tracked through the file modification times. Information on a
+ * render, like its loudness, is kept in a small text file next to it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+#include "defines.h"
+#include "hash.h"
+#include "cache.h"
+
+// Age after which leftover temporary files are removed (in seconds)
+#define STALE_TMP	(24 * 60 * 60)
+
+struct CacheEntry
+{
+  std::string	name;
+  time_t	mtime;
+  off_t		size;
+
+  bool operator<(const CacheEntry &e) const { return mtime < e.mtime; }
+};
+
+RenderCache::RenderCache(const char *ndir, unsigned long long nmaxsize)
+  : dir(ndir), maxsize(nmaxsize)
+{
+  if(mkdir(ndir, 0755) && errno != EEXIST)
+    message(MSG_WARN, "cannot create cache directory -- %s: %s", ndir,
+	    strerror(errno));
+}
+
+bool RenderCache::getkey(const MmapProvider &fp, const std::string &params,
+			 std::string &key)
+/*
+ * The song is hashed from the files 'fp' already holds, so it isn't read
+ * again, and songs in archives and their companion files are covered.
+ */
+{
+  Hash64 h;
+
+  if(!fp.hash(h)) return false;
+  h.update("", 1);
+  h.update(params);
+  key = h.hexdigest();
+  return true;
+}
+
+std::string RenderCache::tmppath(const std::string &key)
+{
+  char pid[32];
+
+  snprintf(pid, sizeof(pid), ".tmp.%ld", (long)getpid());
+  return path(key) + pid;
+}
+
+FILE *RenderCache::lookup(const std::string &key)
+{
+  std::string	fn = path(key);
+  FILE		*f = fopen(fn.c_str(), "rb");
+
+  if(f) utime(fn.c_str(), NULL);	// mark as recently used
+  return f;
+}
+
+FILE *RenderCache::store(const std::string &key)
+{
+  std::string	fn = tmppath(key);
+  FILE		*f = fopen(fn.c_str(), "w+b");
+
+  if(!f)
+    message(MSG_WARN, "cannot write to render cache -- %s: %s", fn.c_str(),
+	    strerror(errno));
+  return f;
+}
+
+void RenderCache::commit(const std::string &key, FILE *f, bool complete)
+{
+  std::string tmp = tmppath(key);
+
+  if(fclose(f) || !complete || rename(tmp.c_str(), path(key).c_str())) {
+    unlink(tmp.c_str());
+    return;
+  }
+
+  evict();
+}
+
+bool RenderCache::getinfo(const std::string &key, std::string &info)
+{
+  FILE	*f = fopen(infopath(key).c_str(), "r");
+  char	buf[256];
+  bool	ok;
+
+  if(!f) return false;
+  ok = fgets(buf, sizeof(buf), f) != NULL;
+  fclose(f);
+  if(ok) info = std::string(buf, strcspn(buf, "\n"));
+  return ok;
+}
+
+void RenderCache::putinfo(const std::string &key, const std::string &info)
+{
+  std::string	tmp = tmppath(key) + ".info", fn = infopath(key);
+  FILE		*f = fopen(tmp.c_str(), "w");
+
+  if(!f) return;
+  fprintf(f, "%s\n", info.c_str());
+  if(fclose(f) || rename(tmp.c_str(), fn.c_str())) unlink(tmp.c_str());
+}
+
+void RenderCache::evict()
+/*
+ * Remove the least recently used renders until the cache fits into its
+ * size limit. Also removes temporary files left behind by killed
+ * processes.
+ */
+{
+  DIR				*d = opendir(dir.c_str());
+  struct dirent			*de;
+  struct stat			st;
+  std::vector<CacheEntry>	entries;
+  CacheEntry			e;
+  unsigned long long		total = 0;
+  time_t			now = time(NULL);
+  unsigned int			i;
+
+  if(!d) return;
+
+  while((de = readdir(d))) {
+    const char *ext = strstr(de->d_name, ".pcm");
+
+    if(!ext || (ext[4] && strncmp(ext + 4, ".tmp.", 5))) continue;
+    e.name = dir + "/" + de->d_name;
+    if(stat(e.name.c_str(), &st) || !S_ISREG(st.st_mode)) continue;
+
+    if(ext[4]) {
+      if(now - st.st_mtime > STALE_TMP) unlink(e.name.c_str());
+      continue;
+    }
+
+    e.mtime = st.st_mtime; e.size = st.st_size;
+    total += st.st_size;
+    entries.push_back(e);
+  }
+  closedir(d);
+
+  std::sort(entries.begin(), entries.end());
+  for(i = 0; i < entries.size() && total > maxsize; i++) {
+    message(MSG_DEBUG, "removing from render cache -- %s",
+	    entries[i].name.c_str());
+    if(!unlink(entries[i].name.c_str())) total -= entries[i].size;
+    unlink((entries[i].name.substr(0, entries[i].name.size() - 4) +
+	    ".info").c_str());
+  }
+}
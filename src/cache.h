@@ -0,0 +1,69 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * cache.h - On-disk cache of rendered PCM data, keyed by song file content
+ * and render parameters.
+ */
+
+#ifndef H_CACHE
+#define H_CACHE
+
+#include <stdio.h>
+#include <string>
+
+#include "provider.h"
+
+class RenderCache
+{
+public:
+  RenderCache(const char *ndir, unsigned long long nmaxsize);
+
+  // Compute the key of rendering the song loaded through 'fp' with
+  // 'params' into 'key'. Returns false if 'fp' served no files.
+  bool getkey(const MmapProvider &fp, const std::string &params,
+	      std::string &key);
+
+  // Open the cached render of 'key' for reading. Returns 0 on a miss.
+  FILE *lookup(const std::string &key);
+
+  // Start a new render of 'key'. Returns the file to write it to, which
+  // may also be read back.
+  FILE *store(const std::string &key);
+
+  // Close a render started with store() and add it to the cache, if it
+  // is 'complete'. Otherwise it is discarded.
+  void commit(const std::string &key, FILE *f, bool complete);
+
+  // Get and set a line of information on the cached render of 'key',
+  // which is removed along with it. get returns false if there is none.
+  bool getinfo(const std::string &key, std::string &info);
+  void putinfo(const std::string &key, const std::string &info);
+
+private:
+  std::string path(const std::string &key) { return dir + "/" + key + ".pcm"; }
+  std::string infopath(const std::string &key) { return dir + "/" + key + ".info"; }
+  std::string tmppath(const std::string &key);
+  void evict();
+
+  std::string		dir;
+  unsigned long long	maxsize;
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <math.h>
+
+#include "defines.h"
+#include "stats.h"
+#include "schedule.h"
+#include "compare.h"
+
+// Maximum number of samples rendered at once
+#define CHUNK		512
+
+/***** TeeOpl *****/
+
+TeeOpl::TeeOpl(Copl *na, Copl *nb)
+  : a(na), b(nb)
+{
+  // Players may only use features that both chips support
+  currType = a->gettype() == b->gettype() ? a->gettype() : TYPE_OPL2;
+}
+
+void TeeOpl::write(int reg, int val)
+{
+  a->write(reg, val);
+  b->write(reg, val);
+}
+
+void TeeOpl::setchip(int n)
+{
+  Copl::setchip(n);
+  a->setchip(n);
+  b->setchip(n);
+}
+
+void TeeOpl::init()
+{
+  a->init();
+  b->init();
+}
+
+/***** EmuCompare *****/
+
+EmuCompare::EmuCompare(Copl *na, Copl *nb, unsigned long nfreq,
+		       unsigned char nchannels)
+  : a(na), b(nb), tee(na, nb), freq(nfreq), channels(nchannels), count(0),
+    suma(0), sumb(0), sumaa(0), sumbb(0), sumab(0), sumdd(0), peak(0),
+    timea(0), timeb(0)
+{
+  bufa = new short [CHUNK * channels];
+  bufb = new short [CHUNK * channels];
+}
+
+EmuCompare::~EmuCompare()
+{
+  delete [] bufa;
+  delete [] bufb;
+}
+
+void EmuCompare::run(CPlayer *p, unsigned long maxsamples)
+/*
+ * Ticks are scheduled the same way as in EmuPlayer::frame(), and both
+ * chips render the same chunks, one after the other.
+ */
+{
+  TickSchedule	schedule;
+  long		i;
+  unsigned long	done = 0;
+  bool		playing = true;
+  uint64_t	t;
+
+  while(playing && done < maxsamples) {
+    while(schedule.tick(freq))
+      playing = p->update();
+    i = schedule.samples(p->getrefresh(), CHUNK);
+
+    t = FrameStats::now();
+    a->update(bufa, i);
+    timea += FrameStats::now() - t;
+
+    t = FrameStats::now();
+    b->update(bufb, i);
+    timeb += FrameStats::now() - t;
+
+    add(i * channels);
+    done += i;
+  }
+}
+
+void EmuCompare::add(unsigned long n)
+{
+  unsigned long i;
+
+  for(i = 0; i < n; i++) {
+    double x = bufa[i], y = bufb[i], d = fabs(x - y);
+
+    suma += x; sumb += y;
+    sumaa += x * x; sumbb += y * y; sumab += x * y;
+    sumdd += d * d;
+    if(d > peak) peak = d;
+  }
+
+  count += n;
+}
+
+static double decibel(double x)
+/* Level of 'x' relative to 16-bit full scale, in dB. */
+{
+  return x > 0 ? 20 * log10(x / 32768) : -HUGE_VAL;
+}
+
+void EmuCompare::report(FILE *out, const char *name, const char *namea,
+			const char *nameb) const
+/*
+ * Differences are given relative to full scale. The correlation of two
+ * silent renders is taken as 1, and as 0 if only one of them is silent.
+ */
+{
+  double	n = count ? count : 1, seconds = (double)count / channels / freq;
+  double	va = sumaa - suma * suma / n, vb = sumbb - sumb * sumb / n;
+  double	corr;
+
+  if(va > 0 && vb > 0)
+    corr = (sumab - suma * sumb / n) / sqrt(va * vb);
+  else
+    corr = va == vb ? 1 : 0;
+
+  fprintf(out, "%s: %.1f s, rms difference %.1f dB, peak difference %.1f dB, "
+	  "correlation %.6f, %s %.1fx realtime, %s %.1fx realtime\n", name,
+	  seconds, decibel(sqrt(sumdd / n)), decibel(peak), corr,
+	  namea, timea ? seconds * 1e9 / timea : 0,
+	  nameb, timeb ? seconds * 1e9 / timeb : 0);
+}
@@ -0,0 +1,82 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * compare.h - Rendering a song with two emulators in lockstep, to measure
+ * how much their output differs and how fast each one is.
+ */
+
+#ifndef H_COMPARE
+#define H_COMPARE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <adplug/opl.h>
+#include <adplug/player.h>
+
+// Passes all register writes on to two chips
+class TeeOpl: public Copl
+{
+public:
+  TeeOpl(Copl *na, Copl *nb);
+
+  virtual void write(int reg, int val);
+  virtual void setchip(int n);
+  virtual void init();
+
+private:
+  Copl	*a, *b;
+};
+
+class EmuCompare
+{
+public:
+  // Compare 16-bit output of 'channels' channels at 'freq' Hz of chips
+  // 'a' and 'b', which are not owned.
+  EmuCompare(Copl *na, Copl *nb, unsigned long nfreq, unsigned char nchannels);
+  ~EmuCompare();
+
+  // The chip that players have to write to
+  Copl *get_opl() { return &tee; }
+
+  // Render player 'p' with both chips, until the song ends or 'maxsamples'
+  // samples are rendered
+  void run(CPlayer *p, unsigned long maxsamples);
+
+  // Print the comparison of 'name', with chips named 'namea' and 'nameb',
+  // as one line to 'out'
+  void report(FILE *out, const char *name, const char *namea,
+	      const char *nameb) const;
+
+private:
+  Copl		*a, *b;
+  TeeOpl	tee;
+  short		*bufa, *bufb;
+  unsigned long	freq;
+  unsigned char	channels;
+
+  // Sums over all sample values of both chips
+  unsigned long	count;
+  double	suma, sumb, sumaa, sumbb, sumab, sumdd, peak;
+  uint64_t	timea, timeb;		// time spent rendering (in ns)
+
+  void add(unsigned long n);
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Commands are lines of a word and an optional argument. Words may be
+ * abbreviated, e.g. "n" for "next". Input is only read when poll() says
+ * it is there, so partial lines are kept until they are complete. Standard
+ * input stays blocking, as its file description is shared with the shell
+ * and often with standard output. A FIFO stays open when its writers go
+ * away, so commands can come from any number of them.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "defines.h"
+#include "control.h"
+
+static const struct {
+  const char			*name;
+  ControlChannel::Command	command;
+} commands[] = {
+  { "pause", ControlChannel::Pause },
+  { "prev", ControlChannel::Prev },
+  { "next", ControlChannel::Next },
+  { "seek", ControlChannel::Seek },
+  { "subsong", ControlChannel::Subsong },
+  { "mute", ControlChannel::Mute },
+  { "quit", ControlChannel::Quit },
+  { 0, ControlChannel::None }
+};
+
+/***** ControlChannel *****/
+
+ControlChannel::ControlChannel(const char *path)
+  : fd(0), eof(false)
+{
+  // Opening for writing, too, keeps a FIFO from reporting end of file
+  // whenever its last writer closes it
+  if(path && (fd = open(path, O_RDWR | O_NONBLOCK)) < 0) {
+    message(MSG_ERROR, "cannot open control FIFO -- %s: %s", path,
+	    strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+ControlChannel::~ControlChannel()
+{
+  if(fd) close(fd);
+}
+
+ControlChannel::Command ControlChannel::poll(long &arg)
+{
+  char				buf[256];
+  struct pollfd			p;
+  ssize_t			n;
+  std::string::size_type	nl;
+  Command			c = None;
+
+  // A read after poll() reports input can't block, even on a blocking fd
+  p.fd = fd; p.events = POLLIN;
+  while(!eof && ::poll(&p, 1, 0) > 0 && (p.revents & (POLLIN | POLLHUP))) {
+    if((n = read(fd, buf, sizeof(buf))) < 0) {
+      if(errno != EINTR && errno != EAGAIN) break;
+      continue;
+    }
+    if(!n) eof = true;
+    input.append(buf, n);
+  }
+
+  while(c == None && (nl = input.find('\n')) != std::string::npos) {
+    std::string line = input.substr(0, nl);
+
+    input.erase(0, nl + 1);
+    c = parse(line, arg);
+  }
+  return c;
+}
+
+void ControlChannel::wait(int ms)
+{
+  struct pollfd p;
+
+  p.fd = fd; p.events = POLLIN;
+  if(eof || ::poll(&p, 1, ms) < 0 || (p.revents & ~POLLIN))
+    usleep(ms * 1000);
+}
+
+ControlChannel::Command ControlChannel::parse(const std::string &line,
+					      long &arg)
+{
+  std::string::size_type	start = line.find_first_not_of(" \t\r"), end;
+  std::string			word, rest;
+  int				i;
+
+  if(start == std::string::npos) return None;
+  end = line.find_first_of(" \t\r", start);
+  word = line.substr(start, end == std::string::npos ? end : end - start);
+  if(end != std::string::npos) rest = line.substr(end);
+
+  for(i = 0; commands[i].name; i++)
+    if(!strncmp(commands[i].name, word.c_str(), word.size())) break;
+
+  if(!commands[i].name) {
+    message(MSG_WARN, "unknown control command -- %s", word.c_str());
+    return None;
+  }
+
+  if(commands[i].command == Seek)
+    arg = (long)(atof(rest.c_str()) * 1000);
+  else
+    arg = atol(rest.c_str());
+  return commands[i].command;
+}
+
+/***** MuteOpl *****/
+
+// Drum key on bits in register 0xbd played by each channel in rhythm mode
+static const int drum_bits[9] = { 0, 0, 0, 0, 0, 0, 0x10, 0x09, 0x06 };
+
+MuteOpl::MuteOpl(Copl *nopl)
+  : opl(nopl)
+{
+  currType = opl->gettype();
+  memset(keys, 0, sizeof(keys));
+  memset(rhythm, 0, sizeof(rhythm));
+  memset(muteflag, 0, sizeof(muteflag));
+}
+
+int MuteOpl::muteddrums(int chip) const
+/* Return the drum key on bits of the muted channels of 'chip'. */
+{
+  int c, bits = 0;
+
+  for(c = 6; c < 9; c++)
+    if(muteflag[chip][c]) bits |= drum_bits[c];
+  return bits;
+}
+
+void MuteOpl::write(int reg, int val)
+{
+  int chip = (reg & 0x100) ? 1 : currChip, r = reg & 0xff;
+
+  if(r >= 0xb0 && r <= 0xb8) {
+    keys[chip][r - 0xb0] = val;
+    if(muteflag[chip][r - 0xb0]) val &= ~0x20;
+  } else if(r == 0xbd) {
+    rhythm[chip] = val;
+    if(val & 0x20) val &= ~muteddrums(chip);
+  }
+
+  opl->write(reg, val);
+}
+
+void MuteOpl::setchip(int n)
+{
+  Copl::setchip(n);
+  opl->setchip(n);
+}
+
+void MuteOpl::init()
+{
+  memset(keys, 0, sizeof(keys));
+  memset(rhythm, 0, sizeof(rhythm));
+  opl->init();
+}
+
+void MuteOpl::mute(int n, bool on)
+{
+  int chip = n / 9, c = n % 9;
+
+  if(n < 0 || n >= 18) return;
+  muteflag[chip][c] = on;
+  if(!on) return;
+
+  opl->setchip(chip);
+  if(keys[chip][c] & 0x20)
+    opl->write(0xb0 + c, keys[chip][c] & ~0x20);
+  if((rhythm[chip] & 0x20) && (rhythm[chip] & drum_bits[c]))
+    opl->write(0xbd, rhythm[chip] & ~muteddrums(chip));
+  opl->setchip(currChip);
+}
@@ -0,0 +1,80 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * control.h - Commands that control playback, read from standard input
+ * or a FIFO without blocking the render loop.
+ */
+
+#ifndef H_CONTROL
+#define H_CONTROL
+
+#include <string>
+#include <adplug/opl.h>
+
+class ControlChannel
+{
+public:
+  enum Command { None, Pause, Prev, Next, Seek, Subsong, Mute, Quit };
+
+  // Read commands from the FIFO 'path', or from standard input if 0
+  ControlChannel(const char *path);
+  ~ControlChannel();
+
+  // Return the next command that has been received, or None. Sets 'arg'
+  // to its argument, which is in milliseconds for Seek.
+  Command poll(long &arg);
+
+  // Wait up to 'ms' milliseconds for more commands
+  void wait(int ms);
+
+private:
+  int		fd;
+  bool		eof;
+  std::string	input;		// received, but not yet taken
+
+  Command parse(const std::string &line, long &arg);
+};
+
+// Passes all register writes on to another chip, keeping muted channels
+// from keying on
+class MuteOpl: public Copl
+{
+public:
+  MuteOpl(Copl *nopl);
+
+  virtual void write(int reg, int val);
+  virtual void setchip(int n);
+  virtual void init();
+
+  // Mute channel 'n' (0 - 17) if 'on', or let it play again. Muting keys
+  // off the channel, along with its drums in rhythm mode.
+  void mute(int n, bool on);
+  bool muted(int n) const { return n >= 0 && n < 18 && muteflag[n / 9][n % 9]; }
+
+private:
+  int muteddrums(int chip) const;
+
+  Copl		*opl;
+  unsigned char	keys[2][9];		// last written 0xb0 - 0xb8
+  unsigned char	rhythm[2];		// last written 0xbd
+  bool		muteflag[2][9];
+};
+
+#endif
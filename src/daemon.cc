@@ -0,0 +1,401 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * The daemon listens on a UNIX domain socket and handles one request per
+ * connection. A request consists of "key=value" lines, terminated by an
+ * empty line:
+ *
+ *   file=/path/to/song.d00
+ *   subsong=2
+ *   emulator=woody
+ *   freq=44100
+ *   bits=16
+ *   mode=surround		(mono, stereo or surround)
+ *   start=10000		(milliseconds)
+ *   length=30000		(milliseconds, 0 plays the song once)
+ *
+ * Only "file" is mandatory. The reply is a line "OK <freq> <bits>
+ * <channels>", followed by raw PCM data until the connection is closed,
+ * or a line "ERROR <reason>".
+ *
+ * Requests are handled by a fixed number of preforked worker processes,
+ * which inherit the loaded database. Each worker keeps its emulators
+ * around for further requests in the same output format.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <vector>
+#include <adplug/adplug.h>
+
+#include "defines.h"
+#include "output.h"
+#include "daemon.h"
+#include "provider.h"
+#include "loader.h"
+
+// Maximum size of a request
+#define REQUEST_MAX	4096
+
+// Seconds to wait for a complete request
+#define REQUEST_TIMEOUT	10
+
+// Number of emulators kept by each worker
+#define POOL_SIZE	8
+
+/***** SocketWriter *****/
+
+class SocketWriter: public EmuPlayer
+{
+public:
+  SocketWriter(Copl *nopl, int nfd, unsigned char nbits,
+	       unsigned char nchannels, unsigned long nfreq,
+	       unsigned long nbufsize, unsigned long nlimit)
+    : EmuPlayer(nopl, nbits, nchannels, nfreq, nbufsize), fd(nfd),
+      left(nlimit), failed(false)
+  { }
+
+  // True, once the requested length is written or the client went away
+  bool done() { return failed || !left; }
+
+protected:
+  virtual void output(const void *buf, unsigned long size);
+
+private:
+  int		fd;
+  unsigned long	left;	// bytes left to write
+  bool		failed;
+};
+
+static bool write_all(int fd, const void *buf, unsigned long size)
+{
+  const char	*pos = (const char *)buf;
+  ssize_t	n;
+
+  while(size) {
+    n = write(fd, pos, size);
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      return false;
+    }
+    pos += n; size -= n;
+  }
+
+  return true;
+}
+
+void SocketWriter::output(const void *buf, unsigned long size)
+{
+  size = MIN(size, left);
+  if(!write_all(fd, buf, size)) failed = true;
+  left -= size;
+}
+
+/***** Emulator pool *****/
+
+static std::vector<RenderRequest>	pool_formats;
+static std::vector<Copl *>		pool_opls;
+
+static Copl *pool_get(const RenderRequest &req)
+/*
+ * Return an emulator for the output format of 'req', constructing it if
+ * the pool has none yet. Returns 0 on unsupported formats.
+ */
+{
+  unsigned int	i;
+  Copl		*opl;
+
+  for(i = 0; i < pool_opls.size(); i++)
+    if(pool_formats[i].emutype == req.emutype &&
+       pool_formats[i].freq == req.freq && pool_formats[i].bits == req.bits &&
+       pool_formats[i].channels == req.channels &&
+       pool_formats[i].harmonic == req.harmonic)
+      return pool_opls[i];
+
+  opl = emu_create(req.emutype, req.freq, req.bits, req.channels,
+		   req.harmonic);
+  if(!opl) return 0;
+
+  // Drop the oldest emulator if the pool is full
+  if(pool_opls.size() >= POOL_SIZE) {
+    delete pool_opls.front();
+    pool_opls.erase(pool_opls.begin());
+    pool_formats.erase(pool_formats.begin());
+  }
+
+  pool_formats.push_back(req);
+  pool_opls.push_back(opl);
+  return opl;
+}
+
+/***** Request handling *****/
+
+static LoaderIndex loaders;
+
+static void reply(int fd, const char *fmt, ...)
+{
+  char		line[256];
+  va_list	argptr;
+
+  va_start(argptr, fmt);
+  vsnprintf(line, sizeof(line) - 1, fmt, argptr);
+  va_end(argptr);
+  strcat(line, "\n");
+  write_all(fd, line, strlen(line));
+}
+
+static bool parse_request(char *buf, RenderRequest &req, const char **err)
+/* Parse the "key=value" lines in 'buf' into 'req'. */
+{
+  char	*line, *value, *next;
+
+  for(line = buf; *line; line = next) {
+    next = strchr(line, '\n');
+    if(next) *next++ = '\0'; else next = line + strlen(line);
+    if(next > line + 1 && next[-2] == '\r') next[-2] = '\0';
+    if(!*line) break;
+
+    if(!(value = strchr(line, '='))) { *err = "malformed request"; return false; }
+    *value++ = '\0';
+
+    if(!strcmp(line, "file")) req.file = value;
+    else if(!strcmp(line, "subsong")) req.subsong = atoi(value);
+    else if(!strcmp(line, "emulator")) {
+      if(!emu_lookup(value, &req.emutype)) { *err = "unknown emulator"; return false; }
+    } else if(!strcmp(line, "freq")) req.freq = atoi(value);
+    else if(!strcmp(line, "bits")) req.bits = atoi(value);
+    else if(!strcmp(line, "mode")) {
+      if(!strcmp(value, "mono")) { req.channels = 1; req.harmonic = false; }
+      else if(!strcmp(value, "stereo")) { req.channels = 2; req.harmonic = false; }
+      else if(!strcmp(value, "surround")) { req.channels = 2; req.harmonic = true; }
+      else { *err = "unknown mode"; return false; }
+    } else if(!strcmp(line, "start")) req.start = strtoul(value, NULL, 10);
+    else if(!strcmp(line, "length")) req.length = strtoul(value, NULL, 10);
+    else { *err = "unknown parameter"; return false; }
+  }
+
+  if(req.file.empty()) { *err = "no file given"; return false; }
+  if(req.bits != 8 && req.bits != 16) { *err = "unsupported sample size"; return false; }
+  if(req.freq <= 0) { *err = "unsupported frequency"; return false; }
+  return true;
+}
+
+static bool read_request(int fd, RenderRequest &req, const char **err)
+/* Read a request from 'fd', up to and including the empty line. */
+{
+  char		buf[REQUEST_MAX];
+  unsigned long	len = 0;
+  ssize_t	n;
+
+  while(len < sizeof(buf) - 1) {
+    n = read(fd, buf + len, sizeof(buf) - 1 - len);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) break;
+    len += n; buf[len] = '\0';
+    if(strstr(buf, "\n\n") || strstr(buf, "\r\n\r\n"))
+      return parse_request(buf, req, err);
+  }
+
+  *err = len < sizeof(buf) - 1 ? "incomplete request" : "request too long";
+  return false;
+}
+
+static void serve(int fd, const RenderRequest &req)
+/* Render 'req' to client 'fd'. */
+{
+  Copl		*opl = pool_get(req);
+  unsigned long	limit = (unsigned long)-1;
+  float		pos = 0;
+
+  if(!opl) { reply(fd, "ERROR unsupported output format"); return; }
+
+  if(req.length)
+    limit = (unsigned long)((double)req.length * req.freq / 1000) *
+      req.channels * (req.bits / 8);
+
+  opl->init();
+  SocketWriter	w(opl, fd, req.bits, req.channels, req.freq, 512, limit);
+
+  w.p = loaders.factory(req.file, opl, MmapProvider(req.file));
+  if(!w.p) {
+    reply(fd, "ERROR unknown filetype");
+    return;
+  }
+
+  // The tick phase is shared by all EmuPlayers, so don't let the previous
+  // request of this worker shift it
+  w.reset();
+  if(req.subsong >= 0) w.p->rewind(req.subsong);
+
+  // Seek to the start position without synthesizing anything. The
+  // emulator still receives all register writes on the way.
+  while(pos < req.start && w.p->update())
+    pos += 1000 / w.p->getrefresh();
+
+  reply(fd, "OK %d %d %d", req.freq, req.bits, req.channels);
+  message(MSG_DEBUG, "rendering '%s'", req.file.c_str());
+
+  do {
+    w.frame();
+  } while(!w.done() && (req.length || w.playing));
+}
+
+/***** Processes *****/
+
+static volatile sig_atomic_t quit = 0;
+
+static void daemon_sighandler(int signal)
+{
+  quit = 1;
+}
+
+static void worker(int sock, const RenderRequest &defaults)
+/* Worker process main loop. Handles requests until killed. */
+{
+  struct timeval	timeout = { REQUEST_TIMEOUT, 0 };
+  RenderRequest		req;
+  const char		*err;
+  int			fd;
+
+  signal(SIGINT, SIG_DFL); signal(SIGTERM, SIG_DFL);
+  signal(SIGPIPE, SIG_IGN);
+
+  // Construct the default emulator right away
+  pool_get(defaults);
+
+  for(;;) {
+    if((fd = accept(sock, NULL, NULL)) < 0) {
+      if(errno == EINTR || errno == ECONNABORTED) continue;
+      message(MSG_ERROR, "accept failed -- %s", strerror(errno));
+      _exit(EXIT_FAILURE);
+    }
+
+    // Don't let a client that stops talking or reading hold the worker
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    req = defaults;
+    if(read_request(fd, req, &err))
+      serve(fd, req);
+    else
+      reply(fd, "ERROR %s", err);
+
+    close(fd);
+  }
+}
+
+static pid_t spawn(int sock, const RenderRequest &defaults)
+{
+  pid_t pid = fork();
+
+  if(pid < 0)
+    message(MSG_ERROR, "cannot start worker -- %s", strerror(errno));
+  else if(!pid)
+    worker(sock, defaults);
+
+  return pid;
+}
+
+int run_daemon(const char *path, unsigned int workers,
+	       const RenderRequest &defaults)
+{
+  struct sockaddr_un	addr;
+  struct sigaction	sa;
+  struct stat		st;
+  std::vector<pid_t>	pids(workers);
+  unsigned int		i, alive = 0;
+  int			sock, status, ret = EXIT_SUCCESS;
+  pid_t			pid;
+
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    message(MSG_ERROR, "socket path too long -- %s", path);
+    return EXIT_FAILURE;
+  }
+
+  // Remove a stale socket from an earlier run
+  if(!lstat(path, &st) && S_ISSOCK(st.st_mode)) unlink(path);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+     bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+     listen(sock, SOMAXCONN) < 0) {
+    message(MSG_ERROR, "cannot listen on socket -- %s: %s", path,
+	    strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  // Terminate on signals, without restarting wait()
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = daemon_sighandler;
+  sigaction(SIGINT, &sa, NULL); sigaction(SIGTERM, &sa, NULL);
+
+  for(i = 0; i < workers; i++)
+    if((pids[i] = spawn(sock, defaults)) > 0) alive++;
+
+  message(MSG_NOTE, "listening on %s with %u workers", path, alive);
+
+  // Restart workers that died. Workers that gave up on the socket would
+  // only fail again, so they are not restarted.
+  while(!quit && alive) {
+    if((pid = wait(&status)) < 0) {
+      if(errno == EINTR) continue;
+      break;
+    }
+
+    for(i = 0; i < workers; i++)
+      if(pids[i] == pid) {
+	if(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE) {
+	  message(MSG_WARN, "worker %d failed, not restarting", (int)pid);
+	  pids[i] = -1;
+	} else {
+	  message(MSG_WARN, "worker %d died, restarting", (int)pid);
+	  pids[i] = spawn(sock, defaults);
+	}
+	if(pids[i] < 0) alive--;
+	break;
+      }
+  }
+
+  if(!quit) {
+    message(MSG_ERROR, "no workers left, giving up");
+    ret = EXIT_FAILURE;
+  }
+
+  for(i = 0; i < workers; i++)
+    if(pids[i] > 0) kill(pids[i], SIGTERM);
+  while(wait(&status) > 0 || errno == EINTR) ;
+
+  close(sock);
+  unlink(path);
+  return ret;
+}
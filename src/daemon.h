@@ -0,0 +1,49 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * daemon.h - Render daemon, serving PCM renders over a UNIX domain socket.
+ */
+
+#ifndef H_DAEMON
+#define H_DAEMON
+
+#include <string>
+
+#include "emu.h"
+
+// A render request. Times are in milliseconds, a length of 0 renders the
+// song once until its end.
+struct RenderRequest
+{
+  std::string	file;
+  int		subsong;
+  EmuType	emutype;
+  int		freq, bits, channels;
+  bool		harmonic;
+  unsigned long	start, length;
+};
+
+// Serve render requests on UNIX domain socket 'path', using 'workers'
+// worker processes. Parameters missing from a request are taken from
+// 'defaults'. Returns the exit status after being terminated by a signal.
+int run_daemon(const char *path, unsigned int workers,
+	       const RenderRequest &defaults);
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * The compiled database consists of a header, an open addressing hash
+ * table on the record keys and the records in AdPlug's database format.
+ * It is only valid for the machine and the AdPlug version that created
+ * it, and is recompiled whenever any of its source files change.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sstream>
+#include <binstr.h>
+#include <binwrap.h>
+#include <adplug/adplug.h>
+
+#include "defines.h"
+#include "hash.h"
+#include "dbcache.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#define DBCACHE_MAGIC	"ADPLDBC1"
+
+struct DBCacheHeader
+{
+  char		magic[8];
+  uint64_t	signature;	// of the source files
+  uint32_t	slots;		// hash table size, a power of 2
+  uint32_t	records;
+};
+
+struct DBCacheSlot
+{
+  uint32_t	crc32, crc16;
+  uint32_t	offset, length;	// of the record, 0 for empty slots
+};
+
+static uint32_t slot_hash(unsigned long crc16, unsigned long crc32)
+{
+  return (uint32_t)crc32 ^ ((uint32_t)crc16 * 0x9e3779b1U);
+}
+
+DatabaseCache::~DatabaseCache()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if(data) munmap(data, size);
+#endif
+}
+
+void DatabaseCache::addsource(const std::string &path, bool required)
+{
+  Source s;
+
+  s.path = path; s.required = required;
+  sources.push_back(s);
+}
+
+uint64_t DatabaseCache::signature()
+{
+  Hash64	h;
+  struct stat	st;
+  char		buf[64];
+  unsigned int	i;
+
+  h.update(DBCACHE_MAGIC);
+  h.update(CAdPlug::get_version());
+
+  for(i = 0; i < sources.size(); i++) {
+    h.update(sources[i].path.c_str(), sources[i].path.size() + 1);
+    if(stat(sources[i].path.c_str(), &st))
+      strcpy(buf, "-");
+    else
+      snprintf(buf, sizeof(buf), "%lld %lld", (long long)st.st_size,
+	       (long long)st.st_mtime);
+    h.update(buf, strlen(buf) + 1);
+  }
+
+  return h.digest();
+}
+
+void DatabaseCache::loadsources(CAdPlugDatabase &into)
+{
+  unsigned int i;
+
+  for(i = 0; i < sources.size(); i++)
+    if(!into.load(sources[i].path) && sources[i].required)
+      message(MSG_WARN, "could not open database -- %s",
+	      sources[i].path.c_str());
+}
+
+bool DatabaseCache::map()
+/* Map the compiled database, if it is valid for the current sources. */
+{
+#ifdef HAVE_SYS_MMAN_H
+  DBCacheHeader		*h;
+  DBCacheSlot		*slot;
+  struct stat		st;
+  unsigned long		i;
+  bool			valid;
+  int			fd = ::open(cachefile.c_str(), O_RDONLY);
+
+  if(fd < 0) return false;
+  if(fstat(fd, &st) || (unsigned long)st.st_size < sizeof(DBCacheHeader)) {
+    close(fd);
+    return false;
+  }
+
+  size = st.st_size;
+  data = (unsigned char *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED) { data = 0; return false; }
+
+  h = (DBCacheHeader *)data;
+  slot = (DBCacheSlot *)(h + 1);
+  valid = !memcmp(h->magic, DBCACHE_MAGIC, 8) &&
+    h->signature == signature() && h->slots && !(h->slots & (h->slots - 1)) &&
+    (size - sizeof(*h)) / sizeof(*slot) >= h->slots;
+
+  for(i = 0; valid && i < h->slots; i++)
+    valid = slot[i].offset <= size && slot[i].length <= size - slot[i].offset;
+
+  if(!valid) {
+    munmap(data, size);
+    data = 0;
+  }
+
+  return valid;
+#else
+  return false;
+#endif
+}
+
+bool DatabaseCache::compile()
+/* Compile all sources into the cache file. */
+{
+  CAdPlugDatabase		all;
+  CAdPlugDatabase::CRecord	*rec;
+  std::vector<DBCacheSlot>	slots;
+  std::ostringstream		records;
+  binowstream			out(&records);
+  DBCacheHeader			h;
+  DBCacheSlot			s;
+  std::string			tmp, buf;
+  char				pid[32];
+  unsigned long			offset, n = 0, i;
+  FILE				*f;
+
+  message(MSG_DEBUG, "compiling database to %s", cachefile.c_str());
+  loadsources(all);
+  out.setFlag(binio::BigEndian, false); out.setFlag(binio::FloatIEEE);
+
+  // Serialize all records, remembering their keys and positions
+  all.goto_begin();
+  if(all.get_record())
+    do {
+      rec = all.get_record();
+      offset = out.pos();
+      rec->write(out);
+      s.crc16 = rec->key.crc16; s.crc32 = rec->key.crc32;
+      s.offset = offset; s.length = out.pos() - offset;
+      slots.push_back(s);
+      n++;
+    } while(all.go_forward());
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, DBCACHE_MAGIC, 8);
+  h.signature = signature();
+  h.records = n;
+  for(h.slots = 16; h.slots < 2 * n; h.slots *= 2) ;
+
+  // Build the hash table. Records follow it in the file.
+  std::vector<DBCacheSlot> table(h.slots);
+  memset(&table[0], 0, h.slots * sizeof(DBCacheSlot));
+  offset = sizeof(h) + h.slots * sizeof(DBCacheSlot);
+  for(i = 0; i < n; i++) {
+    uint32_t j = slot_hash(slots[i].crc16, slots[i].crc32) & (h.slots - 1);
+
+    while(table[j].length) j = (j + 1) & (h.slots - 1);
+    table[j] = slots[i];
+    table[j].offset += offset;
+  }
+
+  // The directory of the cache is only created once there is something
+  // to keep in it
+  if((i = cachefile.find_last_of('/')) != std::string::npos && i > 0 &&
+     mkdir(cachefile.substr(0, i).c_str(), 0755) && errno != EEXIST)
+    return false;
+
+  // Write to a temporary file, so concurrent readers never see partial data
+  buf = records.str();
+  snprintf(pid, sizeof(pid), ".tmp.%ld", (long)getpid());
+  tmp = cachefile + pid;
+  if(!(f = fopen(tmp.c_str(), "wb"))) return false;
+  if(fwrite(&h, sizeof(h), 1, f) != 1 ||
+     fwrite(&table[0], sizeof(DBCacheSlot), h.slots, f) != h.slots ||
+     (buf.size() && fwrite(buf.data(), buf.size(), 1, f) != 1) ||
+     fclose(f) || rename(tmp.c_str(), cachefile.c_str())) {
+    message(MSG_WARN, "cannot write database cache -- %s: %s",
+	    cachefile.c_str(), strerror(errno));
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void DatabaseCache::open()
+{
+#ifdef HAVE_SYS_MMAN_H
+  unsigned int i;
+#endif
+
+  if(state != Closed) return;
+
+#ifdef HAVE_SYS_MMAN_H
+  if(!cachefile.empty() && map()) {
+    // Compiling reports these, so do the same when using the cache
+    for(i = 0; i < sources.size(); i++)
+      if(sources[i].required && access(sources[i].path.c_str(), R_OK))
+	message(MSG_WARN, "could not open database -- %s",
+		sources[i].path.c_str());
+    state = Mapped;
+    return;
+  }
+
+  if(!cachefile.empty() && compile() && map()) {
+    state = Mapped;
+    return;
+  }
+#endif
+
+  // Fall back to loading everything
+  loadsources(db);
+  state = Loaded;
+}
+
+bool DatabaseCache::insert(unsigned long offset, unsigned long length)
+/* Insert the record at 'offset' into the database. */
+{
+  binisstream			in(data + offset, length);
+  CAdPlugDatabase::CRecord	*rec;
+
+  in.setFlag(binio::BigEndian, false); in.setFlag(binio::FloatIEEE);
+  if(!(rec = CAdPlugDatabase::CRecord::factory(in))) return false;
+  if(!db.insert(rec)) delete rec;	// already there
+  return true;
+}
+
+void DatabaseCache::fetch(binistream &f)
+{
+  DBCacheHeader	*h;
+  DBCacheSlot	*slot;
+  uint32_t	i;
+
+  open();
+  if(state != Mapped) return;
+
+  CAdPlugDatabase::CKey key(f);
+  h = (DBCacheHeader *)data;
+  slot = (DBCacheSlot *)(h + 1);
+
+  for(i = slot_hash(key.crc16, key.crc32) & (h->slots - 1); slot[i].length;
+      i = (i + 1) & (h->slots - 1))
+    if(slot[i].crc16 == key.crc16 && slot[i].crc32 == key.crc32) {
+      insert(slot[i].offset, slot[i].length);
+      return;
+    }
+}
+
+void DatabaseCache::fetchall()
+{
+  DBCacheHeader	*h;
+  DBCacheSlot	*slot;
+  uint32_t	i;
+
+  open();
+  if(state != Mapped) return;
+
+  h = (DBCacheHeader *)data;
+  slot = (DBCacheSlot *)(h + 1);
+  for(i = 0; i < h->slots; i++)
+    if(slot[i].length) insert(slot[i].offset, slot[i].length);
+}
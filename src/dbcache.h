@@ -0,0 +1,97 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * dbcache.h - Compiled form of AdPlug's database files, which is mapped
+ * into memory and only yields the records of songs actually played.
+ */
+
+#ifndef H_DBCACHE
+#define H_DBCACHE
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <adplug/database.h>
+
+// Default file name of AdPlug's database file
+#define ADPLUGDB_FILE		"adplug.db"
+
+// File name of the compiled database in the user's configuration directory
+#define ADPLUGDB_CACHE		"adplug.dbc"
+
+// Default AdPlug user's configuration subdirectory
+#define ADPLUG_CONFDIR		".adplug"
+
+// Default path to AdPlug's system-wide database file
+#ifdef ADPLUG_DATA_DIR
+#  define ADPLUGDB_PATH		ADPLUG_DATA_DIR "/" ADPLUGDB_FILE
+#else
+#  define ADPLUGDB_PATH		ADPLUGDB_FILE
+#endif
+
+class DatabaseCache
+{
+public:
+  DatabaseCache(CAdPlugDatabase &ndb)
+    : db(ndb), data(0), size(0), state(Closed)
+  { }
+  ~DatabaseCache();
+
+  // Add a database file. A missing 'required' file is reported.
+  void addsource(const std::string &path, bool required = false);
+
+  // Keep the compiled database in 'path', creating its directory when
+  // needed. Without one, all sources are loaded into the database on
+  // first use.
+  void setcache(const std::string &path) { cachefile = path; }
+
+  // Read the compiled database (compiling it if needed) now, rather
+  // than on first use
+  void open();
+
+  // Insert the record of the song in 'f', if any, into the database
+  void fetch(binistream &f);
+
+  // Insert all records into the database
+  void fetchall();
+
+  // Identify the current state of all source files
+  uint64_t signature();
+
+private:
+  struct Source {
+    std::string	path;
+    bool	required;
+  };
+
+  bool map();
+  bool compile();
+  void loadsources(CAdPlugDatabase &into);
+  bool insert(unsigned long offset, unsigned long length);
+
+  CAdPlugDatabase	&db;
+  std::vector<Source>	sources;
+  std::string		cachefile;
+  unsigned char		*data;
+  unsigned long		size;
+  enum { Closed, Mapped, Loaded } state;
+};
+
+#endif
@@ -62,6 +62,8 @@ DiskWriter::DiskWriter(Copl *nopl, const char *filename, unsigned char nbits,
 
 DiskWriter::~DiskWriter()
 {
+  unsigned long tagsize;
+
   if(!f) return;
 
   if(samplesize % 2) { // Wave data must end on an even byte boundary
@@ -69,15 +71,58 @@ DiskWriter::~DiskWriter()
     samplesize++;
   }
 
+  tagsize = writetags();
+
   // Write file sizes
   f->seek(40); f->writeInt(samplesize, 4);
-  samplesize += 36; // make absolute filesize (add header size)
+  samplesize += 36 + tagsize; // make absolute filesize (add header size)
   f->seek(4); f->writeInt(samplesize, 4);
 
   // end disk writing
   delete f;
 }
 
+static void write_be32(binostream *f, unsigned long n)
+{
+  int i;
+
+  for(i = 24; i >= 0; i -= 8) f->writeInt((n >> i) & 0xff, 1);
+}
+
+unsigned long DiskWriter::writetags()
+/*
+ * Write the tags as ID3v2.3 user text frames into an "id3 " chunk after
+ * the wave data, which is where common tools look for them. Returns the
+ * size of the chunk.
+ */
+{
+  std::map<std::string, std::string>::const_iterator	i;
+  unsigned long						size = 0;
+
+  if(tags.empty()) return 0;
+
+  for(i = tags.begin(); i != tags.end(); i++)
+    size += 10 + 1 + i->first.size() + 1 + i->second.size();
+
+  f->writeString("id3 ", 4); f->writeInt(10 + size, 4);
+  f->writeString("ID3\3\0\0", 6);
+  write_be32(f, (size & 0x7f) | (size & 0x3f80) << 1 | (size & 0x1fc000) << 2 |
+	     (size & 0xfe00000) << 3);		// synchsafe integer
+
+  for(i = tags.begin(); i != tags.end(); i++) {
+    f->writeString("TXXX", 4);
+    write_be32(f, 1 + i->first.size() + 1 + i->second.size());
+    f->writeInt(0, 2);				// flags
+    f->writeInt(0, 1);				// ISO-8859-1
+    f->writeString(i->first.c_str(), i->first.size() + 1);
+    f->writeString(i->second.c_str(), i->second.size());
+  }
+
+  size += 10;
+  if(size % 2) { f->writeInt(0, 1); size++; }
+  return 8 + size;
+}
+
 void DiskWriter::output(const void *buf, unsigned long size)
 {
   char		*b = (char *)buf;
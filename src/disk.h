@@ -20,6 +20,8 @@
 #ifndef H_DISK
 #define H_DISK
 
+#include <map>
+#include <string>
 #include <binio.h>
 
 #include "output.h"
@@ -31,12 +33,18 @@ public:
 	     unsigned char nchannels, unsigned long nfreq);
   virtual ~DiskWriter();
 
+  virtual void settag(const char *name, const std::string &value)
+    { tags[name] = value; }
+
 protected:
   virtual void output(const void *buf, unsigned long size);
 
 private:
+  unsigned long writetags();
+
   binostream	*f;
   unsigned long samplesize;
+  std::map<std::string, std::string>	tags;
 };
 
 #endif
@@ -0,0 +1,147 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2001 - 2017, 2024 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <adplug/emuopl.h>
+#include <adplug/kemuopl.h>
+#include <adplug/wemuopl.h>
+
+#include "emu.h"
+#include "defines.h"
+
+#ifdef HAVE_ADPLUG_NUKEDOPL
+#include <adplug/nemuopl.h>
+#endif
+#ifdef HAVE_ADPLUG_SURROUND
+#include <adplug/surroundopl.h>
+#endif
+
+static const char *emu_names[] = {
+  "satoh", "ken", "woody",
+#ifdef HAVE_ADPLUG_NUKEDOPL
+  "nuked",
+#endif
+  NULL
+};
+
+bool emu_lookup(const char *name, EmuType *type)
+{
+  for(int i = 0; emu_names[i]; i++)
+    if(!strcmp(name, emu_names[i])) {
+      *type = (EmuType)i;
+      return true;
+    }
+
+  return false;
+}
+
+const char *emu_name(EmuType type)
+{
+  return emu_names[type];
+}
+
+Copl *emu_create(EmuType type, int freq, int bits, int channels, bool harmonic)
+{
+  Copl *opl = 0;
+
+  switch(type) {
+  case Emu_Satoh:
+  	if (harmonic) {
+#ifdef HAVE_ADPLUG_SURROUND
+      COPLprops a, b;
+      a.use16bit = b.use16bit = bits == 16;
+      a.stereo = b.stereo = false;
+      a.opl = new CEmuopl(freq, a.use16bit, a.stereo);
+      b.opl = new CEmuopl(freq, b.use16bit, b.stereo);
+      opl = new CSurroundopl(&a, &b, bits == 16);
+      // CSurroundopl now owns a.opl and b.opl and will free upon destruction
+#else
+      fprintf(stderr, "Surround requires AdPlug v2.2 or newer.  Use --mono "
+      	"or upgrade and recompile AdPlay.\n");
+#endif
+  	} else {
+      opl = new CEmuopl(freq, bits == 16, channels == 2);
+  	}
+    break;
+  case Emu_Ken:
+  	if (harmonic) {
+#ifdef HAVE_ADPLUG_SURROUND
+#ifndef CKEMUOPL_MULTIINSTANCE
+	  message(MSG_PANIC, "Sorry, Ken's emulator only supports one instance "
+	    "so does not work properly in surround mode in old versions of "
+	    "the adplug library.");
+#endif
+      COPLprops a, b;
+      a.use16bit = b.use16bit = bits == 16;
+      a.stereo = b.stereo = false;
+      a.opl = new CKemuopl(freq, a.use16bit, a.stereo);
+      b.opl = new CKemuopl(freq, b.use16bit, b.stereo);
+      opl = new CSurroundopl(&a, &b, bits == 16);
+      // CSurroundopl now owns a and b and will free upon destruction
+#else
+      fprintf(stderr, "Surround requires AdPlug v2.2 or newer.  Use --mono "
+      	"or upgrade and recompile AdPlay.\n");
+#endif
+  	} else {
+  		opl = new CKemuopl(freq, bits == 16, channels == 2);
+  	}
+    break;
+   case Emu_Woody:
+  	if (harmonic) {
+#ifdef HAVE_ADPLUG_SURROUND
+      COPLprops a, b;
+      a.use16bit = b.use16bit = bits == 16;
+      a.stereo = b.stereo = false;
+      a.opl = new CWemuopl(freq, a.use16bit, a.stereo);
+      b.opl = new CWemuopl(freq, b.use16bit, b.stereo);
+      opl = new CSurroundopl(&a, &b, bits == 16);
+      // CSurroundopl now owns a and b and will free upon destruction
+#else
+      fprintf(stderr, "Surround requires AdPlug v2.2 or newer.  Use --mono "
+      	"or upgrade and recompile AdPlay.\n");
+#endif
+  	} else {
+      opl = new CWemuopl(freq, bits == 16, channels == 2);
+  	}
+    break;
+#ifdef HAVE_ADPLUG_NUKEDOPL
+  case Emu_Nuked:
+    if (harmonic) {
+      COPLprops a, b;
+      a.use16bit = b.use16bit = true; // Nuked only supports 16-bit
+      a.stereo = b.stereo = true; // Nuked only supports stereo
+      a.opl = new CNemuopl(freq);
+      b.opl = new CNemuopl(freq);
+      opl = new CSurroundopl(&a, &b, bits == 16); // SurroundOPL can convert to 8-bit though
+      // CSurroundopl now owns a and b and will free upon destruction
+  	} else {
+  		if(bits != 16 || channels != 2) {
+  			fprintf(stderr, "Sorry, Nuked OPL3 emulator only works in stereo 16 bits. "
+  				"Use --stereo and --16bit options.\n");
+  		} else {
+  			opl = new CNemuopl(freq);
+  		}
+  	}
+  	break;
+#endif
+  }
+
+  return opl;
+}
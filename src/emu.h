@@ -0,0 +1,51 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2001 - 2017, 2024 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * emu.h - Construction of AdPlug's OPL emulators, as selected on the
+ * commandline.
+ */
+
+#ifndef H_EMU
+#define H_EMU
+
+#include <adplug/opl.h>
+
+#include "config.h"
+
+typedef enum {
+	Emu_Satoh,
+	Emu_Ken,
+	Emu_Woody,
+#ifdef HAVE_ADPLUG_NUKEDOPL
+	Emu_Nuked,
+#endif
+} EmuType;
+
+// Look up emulator by name. Returns false if there is no such emulator.
+bool emu_lookup(const char *name, EmuType *type);
+
+// Return the name of an emulator.
+const char *emu_name(EmuType type);
+
+// Create an emulator for the given output format. Returns 0 if the
+// emulator can't produce this format.
+Copl *emu_create(EmuType type, int freq, int bits, int channels, bool harmonic);
+
+#endif
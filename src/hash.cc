@@ -0,0 +1,126 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hash.h"
+
+static const uint64_t P1 = 11400714785074694791ULL;
+static const uint64_t P2 = 14029467366897019727ULL;
+static const uint64_t P3 = 1609587929392839161ULL;
+static const uint64_t P4 = 9650029242287828579ULL;
+static const uint64_t P5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p)
+/* Read a little endian 64-bit value, regardless of host byte order. */
+{
+  uint64_t v = 0;
+
+  for(int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+static inline uint32_t read32(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t mix(uint64_t acc, uint64_t input)
+{
+  return rotl(acc + input * P2, 31) * P1;
+}
+
+static inline uint64_t merge(uint64_t acc, uint64_t val)
+{
+  return (acc ^ mix(0, val)) * P1 + P4;
+}
+
+Hash64::Hash64(uint64_t nseed)
+  : seed(nseed), total(0), memsize(0)
+{
+  v[0] = seed + P1 + P2; v[1] = seed + P2;
+  v[2] = seed; v[3] = seed - P1;
+}
+
+void Hash64::update(const void *data, unsigned long size)
+{
+  const unsigned char	*p = (const unsigned char *)data;
+  const unsigned char	*end = p + size;
+
+  total += size;
+
+  // Fill up a previously started stripe first
+  if(memsize) {
+    unsigned long n = 32 - memsize < size ? 32 - memsize : size;
+
+    memcpy(mem + memsize, p, n);
+    memsize += n; p += n;
+    if(memsize < 32) return;
+    for(int i = 0; i < 4; i++) v[i] = mix(v[i], read64(mem + 8 * i));
+    memsize = 0;
+  }
+
+  for(; p + 32 <= end; p += 32)
+    for(int i = 0; i < 4; i++) v[i] = mix(v[i], read64(p + 8 * i));
+
+  memcpy(mem, p, end - p);
+  memsize = end - p;
+}
+
+uint64_t Hash64::digest() const
+{
+  const unsigned char	*p = mem, *end = mem + memsize;
+  uint64_t		h;
+
+  if(total >= 32) {
+    h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+    for(int i = 0; i < 4; i++) h = merge(h, v[i]);
+  } else
+    h = seed + P5;
+
+  h += total;
+
+  for(; p + 8 <= end; p += 8)
+    h = rotl(h ^ mix(0, read64(p)), 27) * P1 + P4;
+  if(p + 4 <= end) {
+    h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+    p += 4;
+  }
+  for(; p < end; p++)
+    h = rotl(h ^ (*p * P5), 11) * P1;
+
+  h ^= h >> 33; h *= P2;
+  h ^= h >> 29; h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+std::string Hash64::hexdigest() const
+{
+  char buf[17];
+
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)digest());
+  return buf;
+}
@@ -0,0 +1,48 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * hash.h - Fast 64-bit hash (XXH64) over a stream of data.
+ */
+
+#ifndef H_HASH
+#define H_HASH
+
+#include <stdint.h>
+#include <string>
+
+class Hash64
+{
+public:
+  Hash64(uint64_t nseed = 0);
+
+  void update(const void *data, unsigned long size);
+  void update(const std::string &s) { update(s.data(), s.size()); }
+  uint64_t digest() const;
+
+  // Digest as 16 digit hexadecimal string
+  std::string hexdigest() const;
+
+private:
+  uint64_t	seed, v[4], total;
+  unsigned char	mem[32];
+  unsigned int	memsize;
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2001 - 2003 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.  
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "hashsink.h"
+
+#define BUFSIZE		512
+
+HashSink::HashSink(Copl *nopl, const char *filename, unsigned char nbits,
+		   unsigned char nchannels, unsigned long nfreq)
+  : EmuPlayer(nopl, nbits, nchannels, nfreq, BUFSIZE), f(stdout),
+    wide(nbits == 16)
+{
+  // If no filename or '-' is given, print to stdout
+  if(filename && strcmp(filename, "-") && !(f = fopen(filename, "w"))) {
+    message(MSG_ERROR, "cannot open file for output -- %s", filename);
+    exit(EXIT_FAILURE);
+  }
+}
+
+HashSink::~HashSink()
+{
+  fprintf(f, "%s\n", hash.hexdigest().c_str());
+  if(f != stdout) fclose(f);
+}
+
+void HashSink::output(const void *buf, unsigned long size)
+/*
+ * Hash 16-bit samples in little endian byte order, so the hash is the
+ * same on all machines.
+ */
+{
+  const unsigned short	one = 1;
+  const unsigned short	*s = (const unsigned short *)buf;
+  unsigned char		le[BUFSIZE * 4];
+  unsigned long		i, n;
+
+  if(!wide || *(const unsigned char *)&one) {
+    hash.update(buf, size);
+    return;
+  }
+
+  // Blocks can be larger than a frame, e.g. from the silence filter
+  for(; size >= 2; size -= n) {
+    n = MIN(size & ~1UL, sizeof(le));
+    for(i = 0; i < n; i += 2, s++) {
+      le[i] = *s & 0xff; le[i + 1] = *s >> 8;
+    }
+    hash.update(le, n);
+  }
+}
@@ -0,0 +1,48 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2001, 2002 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.  
+ */
+
+#ifndef H_HASHSINK
+#define H_HASHSINK
+
+#include <stdio.h>
+
+#include "output.h"
+#include "hash.h"
+
+/*
+ * Hashes the rendered audio instead of playing it, for regression tests.
+ * The hash is printed when the writer is destroyed.
+ */
+class HashSink: public EmuPlayer
+{
+public:
+  HashSink(Copl *nopl, const char *filename, unsigned char nbits,
+	   unsigned char nchannels, unsigned long nfreq);
+  virtual ~HashSink();
+
+protected:
+  virtual void output(const void *buf, unsigned long size);
+
+private:
+  FILE		*f;
+  Hash64	hash;
+  bool		wide;		// 16-bit samples
+};
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * The HTTP streamer renders in realtime and sends the same WAVE stream to
+ * any number of listeners. Each listener has a bounded buffer; listeners
+ * that can't keep up are dropped, so they never stall the renderer.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <vector>
+
+#include "defines.h"
+#include "http.h"
+
+#define DEFAULT_ADDRESS	"127.0.0.1:8000"	// Default listen address
+#define BUFSIZE		1024		// Samples rendered at once
+#define CLIENT_BUFFER	2		// Seconds buffered per listener
+#define RENDER_AHEAD	0.5		// Seconds rendered ahead of realtime
+#define MAX_REQUEST	8192		// Longest request we wait through
+
+static void put_le(std::string &s, unsigned long val, int size)
+/* Append 'val' as 'size' bytes little endian integer to 's'. */
+{
+  for(int i = 0; i < size; i++, val >>= 8)
+    s += (char)(val & 0xff);
+}
+
+HTTPStreamer::HTTPStreamer(Copl *nopl, const char *address,
+			   unsigned char nbits, unsigned char nchannels,
+			   unsigned long nfreq)
+  : EmuPlayer(nopl, nbits, nchannels, nfreq, BUFSIZE), sock(-1), start(0),
+    sent(0)
+{
+  const unsigned short	one = 1;
+  struct addrinfo	hints, *res, *ai;
+  std::string		host, port;
+  const char		*colon;
+  int			on = 1, err;
+
+  // WAVE wants little endian samples
+  swap = nbits == 16 && !*(const unsigned char *)&one;
+
+  if(!address) address = DEFAULT_ADDRESS;
+
+  // Split "[HOST:]PORT", HOST may be an IPv6 address in brackets
+  if((colon = strrchr(address, ':'))) {
+    host.assign(address, colon - address);
+    port = colon + 1;
+  } else
+    port = address;
+  if(host.size() > 1 && host[0] == '[' && host[host.size() - 1] == ']')
+    host = host.substr(1, host.size() - 2);
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  if((err = getaddrinfo(host.empty() ? NULL : host.c_str(), port.c_str(),
+			&hints, &res))) {
+    message(MSG_ERROR, "cannot resolve address -- %s: %s", address,
+	    gai_strerror(err));
+    exit(EXIT_FAILURE);
+  }
+
+  for(ai = res; ai; ai = ai->ai_next) {
+    if((sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0)
+      continue;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if(!bind(sock, ai->ai_addr, ai->ai_addrlen) && !listen(sock, SOMAXCONN))
+      break;
+    close(sock);
+    sock = -1;
+  }
+  freeaddrinfo(res);
+
+  if(sock < 0) {
+    message(MSG_ERROR, "cannot listen on address -- %s", address);
+    exit(EXIT_FAILURE);
+  }
+
+  fcntl(sock, F_SETFL, O_NONBLOCK);
+  signal(SIGPIPE, SIG_IGN);	// we notice disconnects through send()
+
+  bytesps = nfreq * getsampsize();
+  maxbuf = CLIENT_BUFFER * bytesps;
+
+  // HTTP and WAVE headers for every listener. The stream length is
+  // unknown, so the WAVE sizes are set to the maximum.
+  header = "HTTP/1.0 200 OK\r\n"
+    "Content-Type: audio/wav\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "Server: " ADPLAY_VERSION "\r\n\r\n";
+  header += "RIFF"; put_le(header, 0xffffffff, 4); header += "WAVEfmt ";
+  put_le(header, 16, 4); put_le(header, 1, 2); put_le(header, nchannels, 2);
+  put_le(header, nfreq, 4); put_le(header, bytesps, 4);
+  put_le(header, getsampsize(), 2); put_le(header, nbits, 2);
+  header += "data"; put_le(header, 0xffffffff, 4);
+
+  message(MSG_NOTE, "waiting for listeners on %s", address);
+}
+
+HTTPStreamer::~HTTPStreamer()
+{
+  std::list<Client>::iterator i;
+
+  for(i = clients.begin(); i != clients.end(); i++)
+    close(i->fd);
+  close(sock);
+}
+
+void HTTPStreamer::accept_clients()
+{
+  Client	c;
+  int		sndbuf = maxbuf / 4;
+
+  while((c.fd = accept(sock, NULL, NULL)) >= 0) {
+    // Keep the kernel from buffering far more than our own buffer
+    fcntl(c.fd, F_SETFL, O_NONBLOCK);
+    setsockopt(c.fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    c.buf = header;
+    c.pos = 0;
+    c.request = 0; c.newlines = 0;
+    clients.push_back(c);
+    message(MSG_DEBUG, "new listener, %lu listening", clients.size());
+  }
+}
+
+bool HTTPStreamer::queue(Client &c, const void *data, unsigned long size)
+/* Queue 'data' for listener 'c'. Returns false if its buffer is full. */
+{
+  if(c.pos > c.buf.size() / 2) {	// discard what was sent already
+    c.buf.erase(0, c.pos);
+    c.pos = 0;
+  }
+
+  if(c.buf.size() - c.pos + size > maxbuf + header.size()) return false;
+  c.buf.append((const char *)data, size);
+  return true;
+}
+
+bool HTTPStreamer::receive(Client &c)
+/*
+ * Read from listener 'c', which has nothing to say but its request. The
+ * request is skipped up to the empty line that ends its headers. Returns
+ * false if the listener is gone or doesn't behave.
+ */
+{
+  char		buf[512];
+  ssize_t	len, i;
+
+  if((len = recv(c.fd, buf, sizeof(buf), 0)) < 0)
+    return errno == EAGAIN || errno == EINTR;
+  if(!len) return false;	// hung up
+
+  for(i = 0; i < len && c.newlines < 2; i++, c.request++)
+    if(buf[i] == '\n')
+      c.newlines++;
+    else if(buf[i] != '\r')
+      c.newlines = 0;
+
+  return c.newlines == 2 || c.request < MAX_REQUEST;
+}
+
+void HTTPStreamer::flush(long timeout)
+/*
+ * Send queued data to all listeners and accept new ones, waiting at most
+ * 'timeout' milliseconds for either to be possible.
+ */
+{
+  std::vector<struct pollfd>	fds(1);
+  std::list<Client>::iterator	i;
+  unsigned int			n;
+  ssize_t			len;
+
+  fds[0].fd = sock; fds[0].events = POLLIN;
+  for(i = clients.begin(); i != clients.end(); i++) {
+    struct pollfd pfd;
+
+    // Always watch for input, to notice listeners that hang up while
+    // there is nothing to send. Reply only once the request is read.
+    pfd.fd = i->fd;
+    pfd.events = POLLIN;
+    if(i->newlines == 2 && i->pos < i->buf.size()) pfd.events |= POLLOUT;
+    fds.push_back(pfd);
+  }
+
+  if(poll(&fds[0], fds.size(), timeout) <= 0) return;
+
+  for(i = clients.begin(), n = 1; i != clients.end(); n++) {
+    len = 0;
+    if(fds[n].revents & (POLLERR | POLLHUP) ||
+       (fds[n].revents & POLLIN && !receive(*i)))
+      len = -1;
+    else if(fds[n].revents & POLLOUT) {
+      len = send(i->fd, i->buf.data() + i->pos, i->buf.size() - i->pos, 0);
+      if(len < 0 && (errno == EAGAIN || errno == EINTR)) len = 0;
+    }
+
+    if(len < 0) {
+      message(MSG_DEBUG, "listener disconnected");
+      close(i->fd);
+      i = clients.erase(i);
+      continue;
+    }
+    i->pos += len;
+    i++;
+  }
+
+  if(fds[0].revents & POLLIN) accept_clients();
+}
+
+void HTTPStreamer::queue_all(const void *data, unsigned long size)
+/* Queue 'data' for all listeners, dropping those that are too slow. */
+{
+  std::list<Client>::iterator i;
+
+  for(i = clients.begin(); i != clients.end();)
+    if(queue(*i, data, size))
+      i++;
+    else {
+      message(MSG_NOTE, "dropping slow listener");
+      close(i->fd);
+      i = clients.erase(i);
+    }
+}
+
+void HTTPStreamer::output(const void *buf, unsigned long size)
+{
+  const unsigned short	*s = (const unsigned short *)buf;
+  unsigned char		le[BUFSIZE * 4];
+  unsigned long		i, n;
+  double		now;
+
+  accept_clients();
+
+  if(!swap)
+    queue_all(buf, size);
+  else	// byte swap like HashSink, blocks can be larger than a frame
+    for(; size >= 2; size -= n) {
+      n = MIN(size & ~1UL, sizeof(le));
+      for(i = 0; i < n; i += 2, s++) {
+	le[i] = *s & 0xff; le[i + 1] = *s >> 8;
+      }
+      queue_all(le, n);
+    }
+
+  // Stay close to realtime, sending data while waiting
+  if(!start) start = FrameStats::now();
+  sent += (double)size / bytesps;
+  while((now = (FrameStats::now() - start) / 1e9) < sent - RENDER_AHEAD)
+    flush((long)((sent - RENDER_AHEAD - now) * 1000) + 1);
+  flush(0);
+}
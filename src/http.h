@@ -0,0 +1,63 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef H_HTTP
+#define H_HTTP
+
+#include <string>
+#include <list>
+
+#include "output.h"
+
+class HTTPStreamer: public EmuPlayer
+{
+public:
+  HTTPStreamer(Copl *nopl, const char *address, unsigned char nbits,
+	       unsigned char nchannels, unsigned long nfreq);
+  virtual ~HTTPStreamer();
+
+protected:
+  virtual void output(const void *buf, unsigned long size);
+
+private:
+  struct Client {
+    int			fd;
+    std::string		buf;	// queued data, sent up to pos
+    unsigned long	pos;
+    unsigned long	request;	// bytes of the request read
+    int			newlines;	// in a row, 2 ends the request
+  };
+
+  void accept_clients();
+  bool receive(Client &c);
+  bool queue(Client &c, const void *data, unsigned long size);
+  void queue_all(const void *data, unsigned long size);
+  void flush(long timeout);
+
+  int			sock;
+  std::list<Client>	clients;
+  std::string		header;		// HTTP and WAVE headers
+  unsigned long		maxbuf;		// bytes buffered per client
+  unsigned long		bytesps;	// bytes per second
+  uint64_t		start;		// stream start time in nanoseconds
+  double		sent;		// seconds sent
+  bool			swap;		// byte swap samples to little endian
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * A channel is silent once it has been keyed off for the release time of
+ * its slowest operator. The release times assume the slowest envelope
+ * rates for any key scaling, so they err on the long side. Operators
+ * with a release rate of 0 never fade out. Release rates changed after
+ * the key off are not noticed.
+ *
+ * In rhythm mode, channels 6 to 8 are keyed through the drum bits of
+ * register 0xbd instead. Skipping the emulator leaves its vibrato and
+ * tremolo oscillators behind, which is inaudible but makes the output
+ * differ slightly from full emulation.
+ */
+
+#include <string.h>
+#include <limits.h>
+
+#include "defines.h"
+#include "idle.h"
+
+// Time from key off to silence of an operator with release rate 1 (in
+// ms). Each higher rate halves it.
+#define RELEASE_MAX	80000
+
+// Operator slots of the channels (modulator; the carrier is 3 above)
+static const int channel_slot[9] = { 0, 1, 2, 8, 9, 10, 16, 17, 18 };
+
+// Channels of the drums in rhythm mode: hihat, cymbal, tom, snare, bass
+static const int drum_channel[5] = { 7, 8, 8, 7, 6 };
+
+IdleTracker::IdleTracker(Copl *nopl, unsigned long nfreq)
+  : skipped(0), wrong(0), differed(0), peak(0), opl(nopl), freq(nfreq),
+    now(0)
+{
+  currType = opl->gettype();
+  memset(regs, 0, sizeof(regs));
+  memset(fade, 0, sizeof(fade));
+}
+
+void IdleTracker::release(int chip, int channel)
+/* Note that 'channel' of 'chip' was keyed off now. */
+{
+  int		i, rr;
+  unsigned long	t = now;
+
+  for(i = 0; i < 2; i++) {
+    rr = regs[chip][0x80 + channel_slot[channel] + 3 * i] & 15;
+    if(!rr) {
+      fade[chip][channel] = ULONG_MAX;
+      return;
+    }
+    t = MAX(t, now + (unsigned long)((double)RELEASE_MAX / 1000 * freq) /
+	    (1 << (rr - 1)));
+  }
+
+  fade[chip][channel] = t;
+}
+
+void IdleTracker::write(int reg, int val)
+{
+  int		chip = (reg & 0x100) ? 1 : currChip, r = reg & 0xff, i;
+  unsigned char	old = regs[chip][r];
+
+  regs[chip][r] = val;
+
+  if(r >= 0xb0 && r <= 0xb8 && (old & ~val & 0x20))
+    release(chip, r - 0xb0);
+  else if(r == 0xbd && (old & 0x20))
+    for(i = 0; i < 5; i++)
+      if(old & ~((val & 0x20) ? val : 0) & (1 << i))
+	release(chip, drum_channel[i]);
+
+  opl->write(reg, val);
+}
+
+void IdleTracker::setchip(int n)
+{
+  Copl::setchip(n);
+  opl->setchip(n);
+}
+
+void IdleTracker::init()
+{
+  memset(regs, 0, sizeof(regs));
+  memset(fade, 0, sizeof(fade));
+  opl->init();
+}
+
+bool IdleTracker::idle() const
+{
+  int chip, i;
+
+  if(regs[0][0x08] & 0x80) return false;	// CSM speech synthesis
+
+  for(chip = 0; chip < 2; chip++) {
+    if((regs[chip][0xbd] & 0x20) && (regs[chip][0xbd] & 0x1f)) return false;
+
+    for(i = 0; i < 9; i++)
+      if((regs[chip][0xb0 + i] & 0x20) || fade[chip][i] > now) return false;
+  }
+
+  return true;
+}
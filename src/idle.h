@@ -0,0 +1,63 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * idle.h - Tracking whether the OPL chip can make any sound, so the
+ * emulator needn't run while it can't.
+ */
+
+#ifndef H_IDLE
+#define H_IDLE
+
+#include <adplug/opl.h>
+
+// Passes all register writes on to another chip, keeping track of the
+// notes that are still sounding
+class IdleTracker: public Copl
+{
+public:
+  // Track chip 'nopl', rendering at 'nfreq' Hz
+  IdleTracker(Copl *nopl, unsigned long nfreq);
+
+  virtual void write(int reg, int val);
+  virtual void setchip(int n);
+  virtual void init();
+
+  // True if no note is keyed on and all released notes have faded out
+  bool idle() const;
+
+  // Advance the time by 'samples' rendered samples
+  void advance(unsigned long samples) { now += samples; }
+
+  unsigned long	skipped;	// samples not synthesized
+  unsigned long	wrong;		// samples taken as idle that weren't silent
+  unsigned long	differed;	// samples after skipping that differed
+				// from full emulation
+  double	peak;		// largest difference, relative to full scale
+
+private:
+  Copl		*opl;
+  unsigned long	freq, now;
+  unsigned char	regs[2][256];
+  unsigned long	fade[2][9];	// time when each channel is silent
+
+  void release(int chip, int channel);
+};
+
+#endif
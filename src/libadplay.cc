@@ -0,0 +1,383 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * The library renders through EmuPlayer, the same engine as adplay, with
+ * the same database, loop detection and fade out. What an EmuPlayer frame
+ * renders beyond the frames asked for is kept for the next call.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <adplug/adplug.h>
+#include <adplug/silentopl.h>
+
+#include "defines.h"
+#include "emu.h"
+#include "output.h"
+#include "provider.h"
+#include "loader.h"
+#include "dbcache.h"
+#include "loop.h"
+#include "libadplay.h"
+
+// Songs longer than this are considered endless by adplay_length()
+#define MAX_LENGTH	(60 * 60 * 1000)
+
+// Frames rendered at once, like the disk writer does
+#define BUFSIZE		512
+
+// Keeps the output of the engine in memory, until the caller takes it
+class MemoryOutput: public EmuPlayer
+{
+public:
+  MemoryOutput(Copl *nopl, unsigned char nbits, unsigned char nchannels,
+	       unsigned long nfreq)
+    : EmuPlayer(nopl, nbits, nchannels, nfreq, BUFSIZE), pos(0)
+  { }
+
+  std::string	buf;		// rendered, taken up to pos
+  unsigned long	pos;
+
+protected:
+  virtual void output(const void *data, unsigned long size)
+    { buf.append((const char *)data, size); }
+};
+
+struct adplay
+{
+  adplay(const std::string &nname) : fp(nname), name(nname) { }
+
+  MmapProvider	fp;
+  LoaderIndex	loaders;
+  std::string	name, title, author, type, desc;
+  Copl		*opl;
+  MemoryOutput	*out;
+  unsigned long	freq, frames, length;
+  unsigned long	limit, fadetick, fadelen;	// in ticks, ticks, samples
+  unsigned int	subsong, loops;
+  double	fade;
+  int		sampsize;
+  bool		loop, ended;
+};
+
+static char		lasterror[256];
+static CAdPlugDatabase	db;
+static DatabaseCache	dbcache(db);
+
+/***** Global functions *****/
+
+void message(int level, const char *fmt, ...)
+/*
+ * The engine reports through message(). There is no terminal to report
+ * to here, so keep the last problem for adplay_error().
+ */
+{
+  va_list argptr;
+
+  if(level > MSG_WARN) return;
+
+  va_start(argptr, fmt);
+  vsnprintf(lasterror, sizeof(lasterror), fmt, argptr);
+  va_end(argptr);
+}
+
+/***** Local functions *****/
+
+static CPlayer *load(adplay_t *h, Copl *opl)
+/* Construct a player for the song of 'h', with its database record. */
+{
+  static bool	dbready = false;
+  const char	*home = getenv("HOME");
+  binistream	*f;
+
+  // Use the same database files as adplay, without compiling them
+  if(!dbready) {
+    if(home) dbcache.addsource(std::string(home) + "/" ADPLUG_CONFDIR "/"
+			       ADPLUGDB_FILE);
+    dbcache.addsource(ADPLUGDB_PATH);
+    CAdPlug::set_database(&db);
+    dbready = true;
+  }
+
+  if((f = h->fp.open(h->name))) {
+    dbcache.fetch(*f);
+    h->fp.close(f);
+  }
+
+  return h->loaders.factory(h->name, opl, h->fp);
+}
+
+static void findend(adplay_t *h)
+/*
+ * Find where the current subsong ends and fades out, with silent
+ * instances of the song's player, like adplay does.
+ */
+{
+  CSilentopl	silent;
+  ShadowOpl	shadow(&silent, h->opl->gettype());
+  CPlayer	*p;
+  double	len = 0;
+
+  h->limit = h->fadetick = h->fadelen = 0;
+  if(h->loop) return;
+
+  if(h->loops && (p = load(h, &shadow))) {
+    p->rewind(h->subsong);
+    h->limit = loop_end(p, &shadow, h->loops, h->name.c_str());
+    delete p;
+  }
+
+  if(h->fade > 0 && (p = load(h, &shadow))) {
+    p->rewind(h->subsong);
+    h->limit = fade_end(p, h->loops ? h->loops : 1, h->fade, h->limit,
+			h->fadetick, len, h->name.c_str());
+    h->fadelen = (unsigned long)(len * h->freq);
+    delete p;
+  }
+}
+
+static void restart(adplay_t *h)
+/* Rewind to the start of the current subsong. */
+{
+  h->out->reset();
+  h->out->setticklimit(h->limit);
+  h->out->setfade(h->fadetick, h->fadelen);
+  h->out->p->rewind(h->subsong);
+  h->out->playing = true;
+  h->out->buf.clear(); h->out->pos = 0;
+  h->frames = 0; h->ended = false;
+}
+
+static adplay_t *setup(adplay_t *h, const adplay_format *fmt)
+/* Set up the player for the song of 'h', or delete 'h' on failure. */
+{
+  adplay_format	defaults;
+  EmuType	emu;
+  CPlayer	*p = 0;
+
+  if(!fmt) {
+    adplay_format_init(&defaults);
+    fmt = &defaults;
+  }
+
+  h->opl = 0; h->out = 0;
+  if(!fmt->emulator || !emu_lookup(fmt->emulator, &emu))
+    message(MSG_ERROR, "unknown emulator -- %s",
+	    fmt->emulator ? fmt->emulator : "(null)");
+  else if(!fmt->freq || (fmt->bits != 8 && fmt->bits != 16) ||
+	  fmt->channels < 1 || fmt->channels > 2 || fmt->fade < 0)
+    message(MSG_ERROR, "unsupported output format");
+  else if(!(h->opl = emu_create(emu, fmt->freq, fmt->bits, fmt->channels,
+				fmt->surround && fmt->channels == 2)))
+    message(MSG_ERROR, "emulator %s doesn't support this output format",
+	    fmt->emulator);
+  else if(!(p = load(h, h->opl)))
+    message(MSG_ERROR, "unknown filetype -- %s", h->name.c_str());
+
+  if(!p) {
+    delete h->opl;
+    delete h;
+    return 0;
+  }
+
+  h->out = new MemoryOutput(h->opl, fmt->bits, fmt->channels, fmt->freq);
+  h->out->p = p;
+  h->freq = fmt->freq;
+  h->sampsize = fmt->channels * fmt->bits / 8;
+  h->loop = fmt->loop != 0;
+  h->loops = fmt->loops;
+  h->fade = fmt->fade;
+  h->subsong = 0; h->length = 0;
+  h->title = p->gettitle();
+  h->author = p->getauthor();
+  h->type = p->gettype();
+  h->desc = p->getdesc();
+  findend(h);
+  restart(h);
+  return h;
+}
+
+/***** Library interface *****/
+
+const char *adplay_version(void)
+{
+  return ADPLAY_VERSION;
+}
+
+void adplay_format_init(adplay_format *fmt)
+{
+  fmt->emulator = emu_name(Emu_Woody);
+  fmt->freq = 44100;
+  fmt->bits = 16;
+  fmt->channels = 1;
+  fmt->surround = 0;
+  fmt->loop = 0;
+  fmt->loops = 0;
+  fmt->fade = 0;
+}
+
+adplay_t *adplay_open(const char *path, const adplay_format *fmt)
+{
+  if(!path) {
+    message(MSG_ERROR, "no file name given");
+    return 0;
+  }
+
+  return setup(new adplay(path), fmt);
+}
+
+adplay_t *adplay_open_memory(const void *data, size_t size, const char *name,
+			     const adplay_format *fmt)
+{
+  adplay_t *h;
+
+  if(!name || (!data && size)) {
+    message(MSG_ERROR, "no %s given", name ? "song data" : "file name");
+    return 0;
+  }
+
+  h = new adplay(name);
+
+  h->fp.add(name, data, size);
+  return setup(h, fmt);
+}
+
+void adplay_close(adplay_t *h)
+{
+  if(!h) return;
+  delete h->out;	// and the player
+  delete h->opl;
+  delete h;
+}
+
+const char *adplay_error(void)
+{
+  return lasterror;
+}
+
+unsigned long adplay_render(adplay_t *h, void *buf, unsigned long frames)
+{
+  MemoryOutput	*out = h->out;
+  char		*pos = (char *)buf;
+  unsigned long	want = frames * h->sampsize, n;
+
+  while(want) {
+    if(out->pos == out->buf.size()) {
+      if(h->ended) break;
+      out->buf.clear(); out->pos = 0;
+      out->frame();
+      if(!out->playing && !h->loop) h->ended = true;
+      continue;
+    }
+
+    n = MIN(want, out->buf.size() - out->pos);
+    memcpy(pos, out->buf.data() + out->pos, n);
+    out->pos += n; pos += n; want -= n;
+  }
+
+  n = (pos - (char *)buf) / h->sampsize;
+  h->frames += n;
+  return n;
+}
+
+void adplay_seek(adplay_t *h, unsigned long ms)
+/* Play through the song up to 'ms' without rendering, like CPlayer::seek(). */
+{
+  CPlayer	*p = h->out->p;
+  unsigned long	ticks = 0;
+  double	t = 0;
+
+  restart(h);
+  while(t < ms && !h->ended) {
+    t += 1000 / p->getrefresh();
+    ticks++;
+    if(!p->update() && !h->loop) h->ended = true;
+  }
+
+  h->out->skipticks(ticks);
+  h->frames = (unsigned long)((double)ms * h->freq / 1000);
+}
+
+unsigned long adplay_tell(adplay_t *h)
+{
+  return (unsigned long)((double)h->frames * 1000 / h->freq);
+}
+
+unsigned int adplay_subsongs(adplay_t *h)
+{
+  return h->out->p->getsubsongs();
+}
+
+int adplay_subsong(adplay_t *h, unsigned int subsong)
+{
+  if(subsong >= h->out->p->getsubsongs()) {
+    message(MSG_ERROR, "no such subsong -- %u", subsong);
+    return -1;
+  }
+
+  h->subsong = subsong; h->length = 0;
+  findend(h);
+  restart(h);
+  return 0;
+}
+
+const char *adplay_title(adplay_t *h)
+{
+  return h->title.c_str();
+}
+
+const char *adplay_author(adplay_t *h)
+{
+  return h->author.c_str();
+}
+
+const char *adplay_type(adplay_t *h)
+{
+  return h->type.c_str();
+}
+
+const char *adplay_description(adplay_t *h)
+{
+  return h->desc.c_str();
+}
+
+unsigned long adplay_length(adplay_t *h)
+/*
+ * Play the subsong through on a second player, so the position of the
+ * first one is kept.
+ */
+{
+  CSilentopl	silent;
+  CPlayer	*p;
+  double	t = 0;
+
+  if(h->length) return h->length;
+  if(!(p = load(h, &silent))) return 0;
+
+  p->rewind(h->subsong);
+  do
+    t += 1000 / p->getrefresh();
+  while(p->update() && t < MAX_LENGTH);
+
+  delete p;
+  return h->length = (unsigned long)t;
+}
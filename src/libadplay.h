@@ -0,0 +1,130 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * libadplay.h - C interface to AdPlay's playback engine, to render songs
+ * into memory from other programs. Songs are played like adplay plays
+ * them, with AdPlug's database and optionally with loop detection and a
+ * fade out.
+ *
+ * The library is not thread-safe. AdPlug keeps global state: its database,
+ * which the library installs with CAdPlug::set_database(), and tables
+ * shared by some of its players. The last error is global as well. Calls
+ * from several threads must therefore be serialized by the caller, even
+ * for different handles. Programs that use AdPlug themselves should not
+ * install a database of their own.
+ */
+
+#ifndef H_LIBADPLAY
+#define H_LIBADPLAY
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADPLAY_API_VERSION	1
+
+typedef struct adplay adplay_t;
+
+typedef struct adplay_format {
+  const char	*emulator;	/* "satoh", "ken", "woody", "nuked", ... */
+  unsigned long	freq;		/* sample rate in Hz */
+  int		bits;		/* 16 (signed, native endian) or 8 (unsigned) */
+  int		channels;	/* 1 or 2, interleaved */
+  int		surround;	/* harmonic stereo with two chips */
+  int		loop;		/* keep playing after the song ends */
+  unsigned int	loops;		/* end after the song's loop played this
+				   many times, 0 for the player's end */
+  double	fade;		/* fade out over this many seconds before
+				   the end, 0 for none */
+} adplay_format;
+
+/* Return the version of the library, like "AdPlay/UNIX 1.9". */
+const char *adplay_version(void);
+
+/*
+ * Set 'fmt' to the defaults: Woody's emulator, 44100 Hz, 16 bit mono,
+ * played once up to the player's song end, without fading out.
+ */
+void adplay_format_init(adplay_format *fmt);
+
+/*
+ * Open the song 'path', which may also name an archive member as
+ * "archive.zip:member", for rendering in the format 'fmt' (NULL for the
+ * defaults). Returns NULL on failure, see adplay_error().
+ */
+adplay_t *adplay_open(const char *path, const adplay_format *fmt);
+
+/*
+ * Like adplay_open(), but read the song from the 'size' bytes at 'data',
+ * which must stay valid until the handle is closed. The format is told
+ * by the extension of 'name'. Companion files of formats split into
+ * several files are still searched next to 'name' in the file system.
+ */
+adplay_t *adplay_open_memory(const void *data, size_t size, const char *name,
+			     const adplay_format *fmt);
+
+void adplay_close(adplay_t *h);
+
+/*
+ * Return a description of the last failure, or of the last problem
+ * encountered while opening a song. This is shared by all handles and
+ * all threads.
+ */
+const char *adplay_error(void);
+
+/*
+ * Render up to 'frames' frames into 'buf', which holds at least
+ * 'frames' * channels * bits / 8 bytes. Returns the number of frames
+ * rendered, which is less than 'frames' only at the end of the song, and
+ * 0 after it. The output is the same as adplay writes to disk for the
+ * same song and format. With 'loops' set, the song's loop is found by running the
+ * song once in advance, when the song or subsong is selected. If no loop
+ * is found, the song ends at the player's end.
+ */
+unsigned long adplay_render(adplay_t *h, void *buf, unsigned long frames);
+
+/* Seek to 'ms' milliseconds into the current subsong. */
+void adplay_seek(adplay_t *h, unsigned long ms);
+
+/* Return the position in the current subsong in milliseconds. */
+unsigned long adplay_tell(adplay_t *h);
+
+/* Number of subsongs and selection of one, which restarts playback. */
+unsigned int adplay_subsongs(adplay_t *h);
+int adplay_subsong(adplay_t *h, unsigned int subsong);
+
+/*
+ * Song information. Strings are empty when the format doesn't carry
+ * them and stay valid until the handle is closed. The length of the
+ * current subsong is found by playing it through on first request.
+ */
+const char *adplay_title(adplay_t *h);
+const char *adplay_author(adplay_t *h);
+const char *adplay_type(adplay_t *h);
+const char *adplay_description(adplay_t *h);
+unsigned long adplay_length(adplay_t *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
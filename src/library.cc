@@ -0,0 +1,342 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * The index holds one JSON object per line and file, sorted by file name:
+ *
+ *   {"file":"...","size":1234,"mtime":1700000000, ...}
+ *
+ * The members following "mtime" are provided by the DescribeFunc. Files
+ * whose size and modification time are unchanged keep their line.
+ * Directory trees are traversed in worker processes, one per top-level
+ * subdirectory, as stat() dominates on network filesystems.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "defines.h"
+#include "parallel.h"
+#include "library.h"
+
+struct LibraryFile
+{
+  std::string		path;
+  unsigned long long	size;
+  long long		mtime;
+
+  bool operator<(const LibraryFile &f) const { return path < f.path; }
+};
+
+struct IndexEntry
+{
+  unsigned long long	size;
+  long long		mtime;
+  std::string		line;
+};
+
+// State shared with the worker processes
+static std::vector<std::string>	subtrees;
+static std::vector<LibraryFile>	files;
+static std::vector<unsigned int>	changed;
+static DescribeFunc			describe;
+static struct stat			indexst;
+
+std::string json_string(const std::string &s)
+{
+  const unsigned char	*c = (const unsigned char *)s.data();
+  const unsigned char	*end = c + s.size();
+  std::string		out("\"");
+  unsigned int		n, i;
+  char			buf[8];
+
+  for(; c < end; c++)
+    if(*c == '"' || *c == '\\') { out += '\\'; out += *c; }
+    else if(*c == '\n') out += "\\n";
+    else if(*c < 0x20 || *c == 0x7f) {
+      snprintf(buf, sizeof(buf), "\\u%04x", *c);
+      out += buf;
+    } else if(*c < 0x80) out += *c;
+    else {
+      // Length of the UTF-8 sequence starting here, or 0 if invalid
+      n = *c >= 0xf5 ? 0 : *c >= 0xf0 ? 4 : *c >= 0xe0 ? 3 : *c >= 0xc2 ? 2 : 0;
+      for(i = 1; i < n; i++)
+	if(c + i >= end || (c[i] & 0xc0) != 0x80) n = 0;
+
+      if(n) {
+	out.append((const char *)c, n);
+	c += n - 1;
+      } else {
+	out += (char)(0xc0 | (*c >> 6));
+	out += (char)(0x80 | (*c & 0x3f));
+      }
+    }
+
+  return out + '"';
+}
+
+static bool readline(FILE *f, std::string &line)
+{
+  char buf[4096];
+
+  line.clear();
+  while(fgets(buf, sizeof(buf), f)) {
+    line += buf;
+    if(line[line.size() - 1] == '\n') {
+      line.erase(line.size() - 1);
+      return true;
+    }
+  }
+
+  return !line.empty();
+}
+
+/***** Traversal *****/
+
+static void found(const std::string &path, const struct stat &st, FILE *out)
+{
+  // Names with newlines can't be passed on, and the index isn't a song
+  if(path.find('\n') != std::string::npos ||
+     (st.st_dev == indexst.st_dev && st.st_ino == indexst.st_ino))
+    return;
+
+  fprintf(out, "%llu %lld %s\n", (unsigned long long)st.st_size,
+	  (long long)st.st_mtime, path.c_str());
+}
+
+static void walk(const std::string &dir, FILE *out, bool recurse)
+/*
+ * Report all files below 'dir' to 'out'. Subdirectories are only
+ * collected in 'subtrees' unless 'recurse' is set. Symbolic links to
+ * directories are not followed.
+ */
+{
+  DIR		*d = opendir(dir.c_str());
+  struct dirent	*de;
+  struct stat	st;
+  std::string	path;
+
+  if(!d) {
+    message(MSG_WARN, "cannot read directory -- %s: %s", dir.c_str(),
+	    strerror(errno));
+    return;
+  }
+
+  while((de = readdir(d))) {
+    if(!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) continue;
+    path = dir + "/" + de->d_name;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+    if(de->d_type == DT_DIR) {
+      if(recurse) walk(path, out, true); else subtrees.push_back(path);
+      continue;
+    }
+#endif
+
+    if(lstat(path.c_str(), &st)) continue;
+    if(S_ISDIR(st.st_mode)) {
+      if(recurse) walk(path, out, true); else subtrees.push_back(path);
+    } else if(S_ISREG(st.st_mode) || (S_ISLNK(st.st_mode) &&
+				      !stat(path.c_str(), &st) &&
+				      S_ISREG(st.st_mode)))
+      found(path, st, out);
+  }
+
+  closedir(d);
+}
+
+static void walk_subtree(unsigned int item, FILE *out)
+{
+  walk(subtrees[item], out, true);
+}
+
+static bool traverse(char * const *paths, unsigned int npaths,
+		     unsigned int jobs)
+/* Collect all files below 'paths' in 'files', sorted by name. */
+{
+  FILE		*out = tmpfile();
+  struct stat	st;
+  std::string	path, line;
+  LibraryFile	f;
+  unsigned int	i;
+  int		n;
+  bool		ok;
+
+  if(!out) {
+    message(MSG_ERROR, "cannot create temporary file -- %s", strerror(errno));
+    return false;
+  }
+
+  for(i = 0; i < npaths; i++) {
+    path = paths[i];
+    while(path.size() > 1 && path[path.size() - 1] == '/')
+      path.erase(path.size() - 1);
+
+    if(stat(path.c_str(), &st))
+      message(MSG_WARN, "cannot access -- %s: %s", path.c_str(),
+	      strerror(errno));
+    else if(S_ISDIR(st.st_mode))
+      walk(path == "/" ? "" : path, out, false);
+    else
+      found(path, st, out);
+  }
+
+  ok = subtrees.empty() ||
+    run_parallel(subtrees.size(), jobs, walk_subtree, out);
+
+  rewind(out);
+  while(readline(out, line))
+    if(sscanf(line.c_str(), "%llu %lld %n", &f.size, &f.mtime, &n) >= 2) {
+      f.path = line.substr(n);
+      files.push_back(f);
+    }
+  fclose(out);
+
+  std::sort(files.begin(), files.end());
+  return ok;
+}
+
+/***** Index *****/
+
+static std::string index_key(const std::string &line,
+			     std::string::size_type *end = 0)
+/* Return the JSON string of the file name in index line 'line'. */
+{
+  std::string::size_type i;
+
+  if(line.compare(0, 9, "{\"file\":\"")) return std::string();
+  for(i = 9; i < line.size() && line[i] != '"'; i++)
+    if(line[i] == '\\') i++;
+  if(i >= line.size()) return std::string();
+
+  if(end) *end = i + 1;
+  return line.substr(8, i - 7);
+}
+
+static void read_index(const char *index,
+		       std::map<std::string, IndexEntry> &entries)
+{
+  FILE				*f = fopen(index, "r");
+  std::string			line, key;
+  std::string::size_type	end;
+  IndexEntry			e;
+
+  if(!f) return;
+
+  while(readline(f, line)) {
+    key = index_key(line, &end);
+    if(!key.empty() &&
+       sscanf(line.c_str() + end, ",\"size\":%llu,\"mtime\":%lld", &e.size,
+	      &e.mtime) == 2) {
+      e.line = line;
+      entries[key] = e;
+    }
+  }
+
+  fclose(f);
+}
+
+static void describe_changed(unsigned int item, FILE *out)
+{
+  const LibraryFile &f = files[changed[item]];
+
+  fprintf(out, "{\"file\":%s,\"size\":%llu,\"mtime\":%lld",
+	  json_string(f.path).c_str(), f.size, f.mtime);
+  describe(f.path.c_str(), true, out);
+  fputs("}\n", out);
+}
+
+bool update_index(const char *index, char * const *paths, unsigned int npaths,
+		  unsigned int jobs, DescribeFunc ndescribe)
+{
+  std::map<std::string, IndexEntry>		entries, fresh;
+  std::map<std::string, IndexEntry>::iterator	e;
+  std::vector<std::string>			keys;
+  std::string					tmp, line;
+  FILE						*out, *probed;
+  char						pid[32];
+  unsigned int					i, removed;
+  bool						ok;
+
+  describe = ndescribe;
+  if(stat(index, &indexst)) memset(&indexst, 0, sizeof(indexst));
+
+  read_index(index, entries);
+  ok = traverse(paths, npaths, jobs);
+
+  // Find new and modified files
+  removed = entries.size();
+  for(i = 0; i < files.size(); i++) {
+    keys.push_back(json_string(files[i].path));
+    e = entries.find(keys[i]);
+    if(e != entries.end()) removed--;
+    if(e == entries.end() || e->second.size != files[i].size ||
+       e->second.mtime != files[i].mtime)
+      changed.push_back(i);
+  }
+
+  // Describe them in parallel
+  if(!changed.empty()) {
+    if(!(probed = tmpfile())) {
+      message(MSG_ERROR, "cannot create temporary file -- %s",
+	      strerror(errno));
+      return false;
+    }
+
+    ok = run_parallel(changed.size(), jobs, describe_changed, probed) && ok;
+
+    rewind(probed);
+    while(readline(probed, line))
+      fresh[index_key(line)].line = line;
+    fclose(probed);
+  }
+
+  // Write the new index, replacing the old one at once
+  snprintf(pid, sizeof(pid), ".tmp.%ld", (long)getpid());
+  tmp = std::string(index) + pid;
+  if(!(out = fopen(tmp.c_str(), "w"))) {
+    message(MSG_ERROR, "cannot write index -- %s: %s", tmp.c_str(),
+	    strerror(errno));
+    return false;
+  }
+
+  for(i = 0; i < files.size(); i++)
+    if((e = fresh.find(keys[i])) != fresh.end() ||
+       (e = entries.find(keys[i])) != entries.end())
+      fprintf(out, "%s\n", e->second.line.c_str());
+
+  if(fclose(out) || rename(tmp.c_str(), index)) {
+    message(MSG_ERROR, "cannot write index -- %s: %s", index,
+	    strerror(errno));
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  message(MSG_NOTE, "indexed %lu files: %lu new or modified, %u removed",
+	  (unsigned long)files.size(), (unsigned long)changed.size(), removed);
+  return ok;
+}
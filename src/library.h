@@ -0,0 +1,45 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * library.h - Persistent index of the songs in directory trees, which is
+ * updated incrementally.
+ */
+
+#ifndef H_LIBRARY
+#define H_LIBRARY
+
+#include <stdio.h>
+#include <string>
+
+// Writes the JSON members describing song file 'fn' to 'out', each
+// preceded by a comma. Includes song lengths if 'lengths' is set.
+typedef void (*DescribeFunc)(const char *fn, bool lengths, FILE *out);
+
+// Return 's' as JSON string. Bytes that don't form valid UTF-8 are taken
+// as Latin-1, as AdPlug's strings have no defined encoding.
+std::string json_string(const std::string &s);
+
+// Update the index file 'index' to cover all files in 'paths', which are
+// searched recursively. Only new and modified files are described again,
+// in 'jobs' worker processes. Returns false on errors.
+bool update_index(const char *index, char * const *paths, unsigned int npaths,
+		  unsigned int jobs, DescribeFunc describe);
+
+#endif
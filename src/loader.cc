@@ -0,0 +1,117 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <ctype.h>
+#include <set>
+#include <algorithm>
+
+#include "defines.h"
+#include "loader.h"
+
+// Number of leading bytes of a file that identify its format
+#define MAGIC_SIZE	4
+
+static std::string lowercase(std::string s)
+{
+  for(std::string::size_type i = 0; i < s.size(); i++)
+    s[i] = tolower((unsigned char)s[i]);
+  return s;
+}
+
+void LoaderIndex::build()
+/*
+ * Index the loaders by extension. This can't be done on construction,
+ * as the player list may not be initialized yet at that time.
+ */
+{
+  CPlayers::const_iterator	i;
+  const char			*ext;
+  unsigned int			j;
+
+  for(i = players.begin(); i != players.end(); i++)
+    for(j = 0; (ext = (*i)->get_extension(j)); j++)
+      byext[lowercase(ext)].push_back(*i);
+
+  built = true;
+}
+
+CPlayer *LoaderIndex::factory(const std::string &fn, Copl *opl,
+			      const CFileProvider &fp)
+{
+  std::string::size_type		pos;
+  std::string				header;
+  std::vector<const Loaders *>		order;
+  std::map<std::string, Loaders>::iterator	l;
+  std::set<const CPlayerDesc *>		tried;
+  Loaders				all(players.begin(), players.end());
+  binistream				*f;
+  CPlayer				*p;
+  unsigned int				i, j, n = 0;
+
+  if(!built) build();
+  files++;
+
+  // Identify the file by its extension and first bytes
+  pos = fn.find_last_of('.');
+  if(pos != std::string::npos && fn.find('/', pos) == std::string::npos)
+    header = lowercase(fn.substr(pos));
+  if((f = fp.open(fn))) {
+    for(i = 0; i < MAGIC_SIZE; i++) {
+      char c = f->readInt(1);
+      if(f->eof()) break;
+      header += c;
+    }
+    fp.close(f);
+  }
+
+  if((l = byheader.find(header)) != byheader.end())
+    order.push_back(&l->second);
+
+  // All extensions of the file name, e.g. ".mus" and ".ims.mus"
+  for(pos = fn.find('.', fn.find_last_of('/') + 1); pos != std::string::npos;
+      pos = fn.find('.', pos + 1))
+    if((l = byext.find(lowercase(fn.substr(pos)))) != byext.end())
+      order.push_back(&l->second);
+
+  order.push_back(&all);
+
+  for(i = 0; i < order.size(); i++)
+    for(j = 0; j < order[i]->size(); j++) {
+      const CPlayerDesc *pd = (*order[i])[j];
+
+      if(!tried.insert(pd).second || !(p = pd->factory(opl))) continue;
+
+      n++;
+      if(p->load(fn, fp)) {
+	Loaders &known = byheader[header];
+
+	probes += n;
+	message(MSG_DEBUG, "loaded by %s after %u probes -- %s",
+		pd->filetype.c_str(), n, fn.c_str());
+	if(std::find(known.begin(), known.end(), pd) == known.end())
+	  known.insert(known.begin(), pd);
+	return p;
+      }
+
+      delete p;
+    }
+
+  probes += n;
+  return 0;
+}
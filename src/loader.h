@@ -0,0 +1,58 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * loader.h - Player construction with an index of AdPlug's loaders, to
+ * find the one accepting a file in as few probes as possible.
+ */
+
+#ifndef H_LOADER
+#define H_LOADER
+
+#include <string>
+#include <vector>
+#include <map>
+#include <adplug/adplug.h>
+
+class LoaderIndex
+{
+public:
+  LoaderIndex(const CPlayers &nplayers = CAdPlug::players)
+    : files(0), probes(0), players(nplayers), built(false)
+  { }
+
+  // Like CAdPlug::factory(), but tries the loaders that accepted files
+  // with the same extension and header before, then the loaders
+  // registered for the extension, and only then all others.
+  CPlayer *factory(const std::string &fn, Copl *opl, const CFileProvider &fp);
+
+  unsigned long		files, probes;	// statistics
+
+private:
+  typedef std::vector<const CPlayerDesc *> Loaders;
+
+  void build();
+
+  const CPlayers			&players;
+  bool					built;
+  std::map<std::string, Loaders>	byext;		// lower case
+  std::map<std::string, Loaders>	byheader;	// learned
+};
+
+#endif
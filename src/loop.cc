@@ -0,0 +1,238 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * The registers are hashed with Zobrist hashing: each combination of
+ * chip, register and value has its own random number, and the hash is
+ * the XOR of the numbers of all register contents. A write then only
+ * needs to XOR out the old and XOR in the new value.
+ *
+ * A cycle is assumed once a state repeats after at least the minimum
+ * loop length, and the following states keep repeating for a whole cycle
+ * and the confirmation time. Short confirmation times would mistake held
+ * notes for loops. The start of the cycle is then moved back as long as
+ * the states before it repeat, too.
+ */
+
+#include <string.h>
+#include <vector>
+#include <map>
+
+#include "defines.h"
+#include "loop.h"
+
+// Shortest loop found, how long it must repeat to be taken as a loop and
+// how far into the song it is searched for (in seconds)
+#define LOOP_MINLEN		1
+#define LOOP_CONFIRM		8
+#define LOOP_SEARCH		(15 * 60)
+
+// How far into a song the end to fade out at is searched for, per loop
+// (in seconds)
+#define FADE_SEARCH		(15 * 60)
+
+static uint64_t zobrist(int chip, int reg, int val)
+/* Random number of 'val' in 'reg' of 'chip' (splitmix64). Zero is 0. */
+{
+  uint64_t z;
+
+  if(!val) return 0;
+  z = ((uint64_t)chip << 16 | reg << 8 | val) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static uint64_t mix(uint64_t h, uint64_t v)
+{
+  return (h ^ v) * 0x100000001b3ULL + (h >> 29);
+}
+
+/***** ShadowOpl *****/
+
+ShadowOpl::ShadowOpl(Copl *nopl, ChipType ntype)
+  : opl(nopl), hash(0)
+{
+  currType = ntype;
+  memset(regs, 0, sizeof(regs));
+}
+
+void ShadowOpl::write(int reg, int val)
+{
+  unsigned char &r = regs[currChip][reg & 0xff];
+
+  hash ^= zobrist(currChip, reg & 0xff, r) ^ zobrist(currChip, reg & 0xff, val);
+  r = val;
+  opl->write(reg, val);
+}
+
+void ShadowOpl::setchip(int n)
+{
+  Copl::setchip(n);
+  opl->setchip(n);
+}
+
+void ShadowOpl::init()
+{
+  memset(regs, 0, sizeof(regs));
+  hash = 0;
+  opl->init();
+}
+
+/***** LoopCounter *****/
+
+unsigned int LoopCounter::tick(bool playing)
+{
+  ticks++;
+  if(playing)
+    ended = false;
+  else if(!ended) {
+    ended = true;
+    if(!first) first = ticks;
+    since = 0;
+    ends++;
+  } else if(++since == first) {
+    since = 0;
+    ends++;
+  }
+
+  return ends;
+}
+
+/***** Loop detection *****/
+
+bool find_loop(CPlayer *p, ShadowOpl *opl, double minlen, double confirm,
+	       double maxlen, SongLoop &loop)
+{
+  std::vector<uint64_t>				states;
+  std::vector<double>				times;	// at start of tick
+  std::map<uint64_t, unsigned long>		seen;
+  std::map<uint64_t, unsigned long>::iterator	i;
+  unsigned long	t, start = 0, length = 0, matched = 0;
+  double	now = 0, found = 0;
+  uint64_t	state;
+  bool		confirmed = false;
+
+  loop.end = 0;
+  for(t = 0; now < maxlen; t++) {
+    times.push_back(now);
+    now += 1 / p->getrefresh();
+    if(!p->update() && !loop.end) loop.end = t + 1;
+
+    state = mix(mix(mix(mix(opl->gethash(), p->getorder()), p->getpattern()),
+		    p->getrow()), p->getspeed());
+    states.push_back(state);
+
+    // Does the current candidate cycle go on?
+    if(length) {
+      if(states[t - length] != state)
+	length = 0;
+      else if(++matched >= length && now - found >= confirm) {
+	confirmed = true;
+	break;
+      }
+    }
+
+    // Look for a new candidate
+    if(!length && (i = seen.find(state)) != seen.end() &&
+       now - times[i->second + 1] >= minlen) {
+      start = i->second + 1;
+      length = t - i->second;
+      matched = 1;
+      found = times[t];
+    }
+
+    seen.insert(std::make_pair(state, t));
+  }
+
+  if(!confirmed) return false;
+
+  // states[start - 1] is the state the loop starts from
+  while(start > 1 && states[start - 2] == states[start - 2 + length])
+    start--;
+
+  loop.start = start;
+  loop.length = length;
+  loop.still = true;
+  for(t = start; t < start - 1 + length && loop.still; t++)
+    loop.still = states[t] == states[start - 1];
+  return true;
+}
+
+/***** Song ends *****/
+
+unsigned long loop_end(CPlayer *p, ShadowOpl *opl, unsigned int loops,
+		       const char *fn)
+/*
+ * Registers left over from the end of the song can delay the start of
+ * the exact repetition, so the player's own song end is used as the end
+ * of the first loop, if it signals one after that start. A song that ends
+ * in a still state plays that state once, so notes can fade out.
+ */
+{
+  SongLoop loop;
+
+  if(!find_loop(p, opl, LOOP_MINLEN, LOOP_CONFIRM, LOOP_SEARCH, loop)) {
+    message(MSG_NOTE, "no loop found, using the player's song end -- %s", fn);
+    return 0;
+  }
+
+  message(MSG_DEBUG, "loop of %lu ticks at tick %lu%s -- %s", loop.length,
+	  loop.start, loop.still ? ", song ended" : "", fn);
+  if(loop.still)
+    return loop.start + loop.length;
+  if(loop.end >= loop.start)
+    return loop.end + (loops - 1) * loop.length;
+  return loop.start + loops * loop.length;
+}
+
+unsigned long fade_end(CPlayer *p, unsigned int loops, double fade,
+		       unsigned long limit, unsigned long &fadetick,
+		       double &fadelen, const char *fn)
+{
+  std::vector<double>	times;
+  double		now = 0, maxlen = (double)FADE_SEARCH * loops;
+  unsigned long		end = limit, t;
+  LoopCounter		counter;
+
+  fadetick = 0; fadelen = 0;
+
+  // times[t] is the time at which tick t starts playing
+  for(t = 0; !end || t < end; t++) {
+    bool playing;
+
+    if(now > maxlen) break;
+    times.push_back(now);
+    playing = p->update();
+    now += 1 / p->getrefresh();
+    // A loop need not replay the intro, so count the actual song ends
+    if(!limit && counter.tick(playing) >= loops) end = t + 1;
+  }
+
+  if(!end || t < end) {
+    message(MSG_NOTE, "song end not found, not fading out -- %s", fn);
+    return limit;
+  }
+
+  for(t = 0; t < end - 1 && now - times[t] > fade; t++) ;
+  message(MSG_DEBUG, "fading out over %.1f s from tick %lu of %lu -- %s",
+	  now - times[t], t, end, fn);
+  fadetick = t; fadelen = now - times[t];
+  return end;
+}
@@ -0,0 +1,101 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * loop.h - Detection of a song's loop, by finding the point where the
+ * sequence of player states starts to repeat. A player state is the
+ * content of all OPL registers together with the song position.
+ */
+
+#ifndef H_LOOP
+#define H_LOOP
+
+#include <stdint.h>
+#include <adplug/opl.h>
+#include <adplug/player.h>
+
+// Keeps a copy of all registers written to another chip, along with a
+// hash of them that is updated with every write
+class ShadowOpl: public Copl
+{
+public:
+  // Pass writes on to 'nopl', announcing chip type 'ntype' to players
+  ShadowOpl(Copl *nopl, ChipType ntype);
+
+  virtual void write(int reg, int val);
+  virtual void setchip(int n);
+  virtual void init();
+
+  uint64_t gethash() const { return hash; }
+
+private:
+  Copl		*opl;
+  unsigned char	regs[2][256];
+  uint64_t	hash;
+};
+
+// Counts the song ends reported by a player's update(), one tick at a
+// time. Most players keep reporting the end once they reached it. While
+// they do, another end is counted for every length of the first pass.
+class LoopCounter
+{
+public:
+  LoopCounter() : ticks(0), first(0), since(0), ends(0), ended(false) { }
+
+  // Count a tick, on which update() returned 'playing'. Returns the
+  // number of song ends so far.
+  unsigned int tick(bool playing);
+
+private:
+  unsigned long	ticks, first, since;
+  unsigned int	ends;
+  bool		ended;
+};
+
+struct SongLoop
+{
+  unsigned long	start, length;	// in ticks
+  unsigned long	end;		// ticks until the player's song end, or 0
+  bool		still;		// nothing happens in the loop anymore
+};
+
+// Tick player 'p', which must write to 'opl', until its states repeat in
+// a cycle of at least 'minlen' seconds, for at least one cycle and
+// 'confirm' seconds. Returns false if no cycle is found within 'maxlen'
+// seconds.
+bool find_loop(CPlayer *p, ShadowOpl *opl, double minlen, double confirm,
+	       double maxlen, SongLoop &loop);
+
+// Return the number of ticks of player 'p', which must write to 'opl',
+// that play the song's loop 'loops' times, or 0 if no loop is found. 'fn'
+// names the song in messages.
+unsigned long loop_end(CPlayer *p, ShadowOpl *opl, unsigned int loops,
+		       const char *fn);
+
+// Find where to start fading out over 'fade' seconds before the end of
+// player 'p', which ends after 'limit' ticks, or at the song end that
+// completes 'loops' loops if 'limit' is 0. Sets 'fadetick' to the tick
+// to start at and 'fadelen' to the fade's length in seconds. Returns the
+// number of ticks to play, or 'limit' with 'fadelen' 0 if the end is not
+// found. 'fn' names the song in messages.
+unsigned long fade_end(CPlayer *p, unsigned int loops, double fade,
+		       unsigned long limit, unsigned long &fadetick,
+		       double &fadelen, const char *fn);
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * The audio is K-weighted by two biquad filters, a high shelf modelling
+ * the head and a high pass, and its mean square is taken over 400 ms
+ * blocks that overlap by 75%. Blocks below -70 LUFS and those 10 LU below
+ * the loudness of the remaining ones are gated out. The true peak is
+ * taken from the audio oversampled 4 times by a windowed sinc filter.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "defines.h"
+#include "loudness.h"
+
+// Absolute and relative gate (in LUFS and LU)
+#define GATE_ABSOLUTE	-70.0
+#define GATE_RELATIVE	-10.0
+
+static double lufs(double meansquare)
+{
+  return meansquare > 0 ? -0.691 + 10 * log10(meansquare) : -HUGE_VAL;
+}
+
+static double meansquare(double lufs)
+{
+  return pow(10, (lufs + 0.691) / 10);
+}
+
+Loudness::Loudness(unsigned char nbits, unsigned char nchannels,
+		   unsigned long nfreq)
+  : bits(nbits), channels(nchannels), step(nfreq / 10), chan(nchannels)
+{
+  double	k, q, vh, vb, a0;
+  int		i, j;
+
+  // High shelf of +4 dB above 1.7 kHz and high pass at 38 Hz, as given
+  // for 48 kHz by BS.1770, for any sample rate
+  k = tan(M_PI * 1681.974450955533 / nfreq); q = 0.7071752369554196;
+  vh = pow(10, 3.999843853973347 / 20); vb = pow(vh, 0.4996667741545416);
+  a0 = 1 + k / q + k * k;
+  b[0][0] = (vh + vb * k / q + k * k) / a0; b[0][1] = 2 * (k * k - vh) / a0;
+  b[0][2] = (vh - vb * k / q + k * k) / a0;
+  a[0][1] = 2 * (k * k - 1) / a0; a[0][2] = (1 - k / q + k * k) / a0;
+
+  k = tan(M_PI * 38.13547087602444 / nfreq); q = 0.5003270373238773;
+  a0 = 1 + k / q + k * k;
+  b[1][0] = 1; b[1][1] = -2; b[1][2] = 1;
+  a[1][1] = 2 * (k * k - 1) / a0; a[1][2] = (1 - k / q + k * k) / a0;
+  a[0][0] = a[1][0] = 1;
+
+  // Hann windowed sinc, each phase normalized to unity gain
+  for(i = 0; i < Phases; i++) {
+    double sum = 0;
+
+    for(j = 0; j < Taps; j++) {
+      double	n = j * Phases + i, t = (n - (Taps * Phases - 1) / 2.0) / Phases;
+      double	w = 0.5 - 0.5 * cos(2 * M_PI * (n + 0.5) / (Taps * Phases));
+
+      fir[i][j] = (float)(w * (t ? sin(M_PI * t) / (M_PI * t) : 1));
+      sum += fir[i][j];
+    }
+    for(j = 0; j < Taps; j++) fir[i][j] /= sum;
+  }
+
+  reset();
+}
+
+void Loudness::reset()
+{
+  unsigned int i;
+
+  for(i = 0; i < chan.size(); i++) memset(&chan[i], 0, sizeof(Channel));
+  blocks.clear();
+  pos = nsteps = 0;
+  energy = peak = 0;
+}
+
+void Loudness::filter(Channel &c, float x)
+/*
+ * Run sample 'x' through the K-weighting filters and the oversampling
+ * filter of channel 'c'. The phases of the latter are dot products over
+ * the sample history, which vectorize.
+ */
+{
+  double	y = x;
+  float		m;
+  int		i, j;
+
+  for(i = 0; i < 2; i++) {	// transposed direct form II
+    double out = b[i][0] * y + c.z1[i];
+
+    c.z1[i] = b[i][1] * y - a[i][1] * out + c.z2[i];
+    c.z2[i] = b[i][2] * y - a[i][2] * out;
+    y = out;
+  }
+  energy += y * y;
+
+  memmove(c.hist + 1, c.hist, (Taps - 1) * sizeof(float));
+  c.hist[0] = x;
+  for(i = 0; i < Phases; i++) {
+    float s = 0;
+
+    for(j = 0; j < Taps; j++) s += fir[i][j] * c.hist[j];
+    m = fabsf(s);
+    if(m > peak) peak = m;
+  }
+}
+
+void Loudness::process(const void *buf, unsigned long size)
+{
+  unsigned long n = size / (channels * (bits / 8)), i;
+  int c;
+
+  for(i = 0; i < n; i++) {
+    for(c = 0; c < channels; c++) {
+      unsigned long	k = i * channels + c;
+      float		x = bits == 16 ? ((const short *)buf)[k] / 32768.0f :
+	(((const unsigned char *)buf)[k] - 128) / 128.0f;
+
+      filter(chan[c], x);
+    }
+
+    if(++pos < step) continue;
+
+    // A block is complete with every step from the fourth on
+    if(nsteps >= 3)
+      blocks.push_back((steps[0] + steps[1] + steps[2] + energy) / (4 * step));
+    steps[0] = steps[1]; steps[1] = steps[2]; steps[2] = energy;
+    nsteps++;
+    energy = 0;
+    pos = 0;
+  }
+}
+
+void Loudness::merge(const Loudness &l)
+{
+  blocks.insert(blocks.end(), l.blocks.begin(), l.blocks.end());
+  if(l.peak > peak) peak = l.peak;
+}
+
+double Loudness::integrated() const
+{
+  double	gate = meansquare(GATE_ABSOLUTE), sum;
+  unsigned long	i, n;
+  int		pass;
+
+  // Gate absolutely, then relative to the loudness of that
+  for(pass = 0; pass < 2; pass++) {
+    for(sum = 0, n = 0, i = 0; i < blocks.size(); i++)
+      if(blocks[i] > gate) { sum += blocks[i]; n++; }
+    if(!n) return -HUGE_VAL;
+    gate = MAX(gate, meansquare(lufs(sum / n) + GATE_RELATIVE));
+  }
+
+  return lufs(sum / n);
+}
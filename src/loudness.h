@@ -0,0 +1,77 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * loudness.h - Loudness measurement after EBU R128 (ITU-R BS.1770).
+ */
+
+#ifndef H_LOUDNESS
+#define H_LOUDNESS
+
+#include <vector>
+
+// ReplayGain 2.0 reference loudness (in LUFS)
+#define REPLAYGAIN_REFERENCE	-18.0
+
+class Loudness
+{
+public:
+  Loudness(unsigned char nbits, unsigned char nchannels, unsigned long nfreq);
+
+  // Start a new measurement
+  void reset();
+
+  // Measure 'size' bytes of audio in 'buf'
+  void process(const void *buf, unsigned long size);
+
+  // Add the measurement of 'l', which must be of the same format
+  void merge(const Loudness &l);
+
+  // Gated integrated loudness (in LUFS), -HUGE_VAL if too short or silent
+  double integrated() const;
+
+  // Largest magnitude of the 4 times oversampled audio, 1 being full scale
+  double truepeak() const { return peak; }
+
+private:
+  // Number of taps of each phase of the oversampling filter
+  enum { Taps = 12, Phases = 4 };
+
+  struct Channel {
+    double	z1[2], z2[2];	// K-weighting filter states
+    float	hist[Taps];	// latest samples, latest first
+  };
+
+  void filter(Channel &c, float x);
+
+  unsigned char		bits, channels;
+  unsigned long		step, pos;	// 100 ms gating steps, in samples
+  double		b[2][3], a[2][3];	// K-weighting biquads
+  float			fir[Phases][Taps];	// oversampling filter
+  std::vector<Channel>	chan;
+  double		energy, steps[3];	// of the current and last steps
+  unsigned long		nsteps;
+  std::vector<double>	blocks;		// mean square of each 400 ms block
+  double		peak;
+};
+
+// ReplayGain of audio of loudness 'lufs' (in dB)
+inline double replaygain(double lufs) { return REPLAYGAIN_REFERENCE - lufs; }
+
+#endif
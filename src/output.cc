@@ -18,11 +18,13 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <adplug/emuopl.h>
 #include <adplug/kemuopl.h>
 
 #include "output.h"
 #include "defines.h"
+#include "probes.h"
 
 /***** Player *****/
 
@@ -38,11 +40,12 @@ Player::~Player()
 
 /***** EmuPlayer *****/
 
-long EmuPlayer::minicnt = 0;
-
 EmuPlayer::EmuPlayer(Copl *nopl, unsigned char nbits, unsigned char nchannels,
 		     unsigned long nfreq, unsigned long nbufsize)
-  : opl(nopl), buf_size(nbufsize), freq(nfreq), bits(nbits), channels(nchannels)
+  : opl(nopl), capture(0), stats(0), silence(0), idle(0), verifyopl(0),
+    loudness(0), discard(false), gain(1), buf_size(nbufsize), freq(nfreq),
+    ticks(0), ticklimit(0), fadetick(0), fadelen(0), fadepos(0), bits(nbits),
+    channels(nchannels)
 {
   audiobuf = new char [buf_size * getsampsize()];
 }
@@ -64,25 +67,167 @@ void EmuPlayer::frame()
 {
   long i, towrite = buf_size;
   char *pos = audiobuf;
+  uint64_t t = stats ? FrameStats::now() : 0;
 
   // Prepare audiobuf with emulator output
   while(towrite > 0) {
-    while(minicnt < 0) {
-      minicnt += freq;
+    while((!ticklimit || ticks < ticklimit) && schedule.tick(freq)) {
+      PROBE_TICK_START();
       playing = p->update();
+      PROBE_TICK_DONE(playing);
+      ticks++;
+      if(stats) t = stats->add(FrameStats::Update, t);
+    }
+    if(schedule.due()) break;	// tick limit reached
+    i = schedule.samples(p->getrefresh(), towrite);
+    if(idle && idle->idle()) {
+      unsigned char	silent = bits == 8 ? 0x80 : 0;
+      long		j, n = i * getsampsize();
+
+      if(verifyopl) {
+	opl->update((short *)pos, i);
+	for(j = 0; j < n && (unsigned char)pos[j] == silent; j++) ;
+	if(j < n) idle->wrong += i;
+      } else
+	memset(pos, silent, n);
+      idle->skipped += i;
+    } else {
+      opl->update((short *)pos, i);
+      if(idle && verifyopl) verifyskip(pos, i);
     }
-    i = MIN(towrite, (long)(minicnt / p->getrefresh() + 4) & ~3);
-    opl->update((short *)pos, i);
+    if(idle) idle->advance(i);
+    if(fadelen && ticks > fadetick) fadeout(pos, i);
+    PROBE_SYNTH(i);
+    if(stats) t = stats->add(FrameStats::Synth, t);
     pos += i * getsampsize(); towrite -= i;
-    i = (long)(p->getrefresh() * i);
-    minicnt -= MAX(1, i);
   }
 
+  // With a tick limit, only the limit ends the song
+  if(ticklimit) playing = towrite == 0;
+  if(towrite == (long)buf_size) return;
+  towrite = buf_size - towrite;
+
   // call output driver
-  output(audiobuf, buf_size * getsampsize());
+  if(silence) {
+    silence->process(*this, audiobuf, towrite * getsampsize());
+    if(silence->stopped()) playing = false;
+  } else
+    outputpcm(audiobuf, towrite * getsampsize());
+  if(stats) {
+    stats->add(FrameStats::Output, t);
+    stats->addaudio((double)towrite / freq);
+  }
+}
+
+void EmuPlayer::fadeout(char *buf, long samples)
+/*
+ * Apply the linear fade out gain to 'samples' samples in 'buf'. The gain
+ * steps with every single sample of every channel, so the loops are
+ * simple enough to be vectorized.
+ */
+{
+  long	i, n = samples * channels;
+  float	gain = 1 - (float)fadepos / fadelen, step = 1.0f / fadelen / channels;
+
+  if(bits == 16) {
+    short *s = (short *)buf;
+
+    for(i = 0; i < n; i++) {
+      float g = gain - step * i;
+
+      s[i] = (short)(s[i] * (g > 0 ? g : 0));
+    }
+  } else {
+    unsigned char *s = (unsigned char *)buf;
+
+    for(i = 0; i < n; i++) {
+      float g = gain - step * i;
+
+      s[i] = (unsigned char)(128 + (s[i] - 128) * (g > 0 ? g : 0));
+    }
+  }
+
+  fadepos += samples;
+}
+
+void EmuPlayer::verifyskip(const char *buf, long samples)
+/*
+ * Render 'samples' samples with the verification chip, which skipped the
+ * idle time, and count them if they differ from 'buf', rendered by full
+ * emulation.
+ */
+{
+  long	i, n = samples * channels, d, peak = 0;
+
+  if(verifybuf.size() < (unsigned long)samples * getsampsize())
+    verifybuf.resize(samples * getsampsize());
+  verifyopl->update((short *)&verifybuf[0], samples);
+
+  if(bits == 16) {
+    const short *a = (const short *)buf, *b = (const short *)&verifybuf[0];
+
+    for(i = 0; i < n; i++)
+      if((d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i]) > peak) peak = d;
+  } else {
+    const unsigned char *a = (const unsigned char *)buf;
+    const unsigned char *b = (const unsigned char *)&verifybuf[0];
+
+    for(i = 0; i < n; i++)
+      if((d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i]) > peak) peak = d;
+  }
+
+  if(peak) {
+    idle->differed += samples;
+    idle->peak = MAX(idle->peak, peak / (bits == 16 ? 32768.0 : 128.0));
+  }
+}
+
+const void *EmuPlayer::amplify(const void *buf, unsigned long size)
+/* Return a copy of 'buf' amplified by the gain, with the output clipped. */
+{
+  unsigned long i, n = size / (bits / 8);
+
+  if(gainbuf.size() < size) gainbuf.resize(size);
+
+  if(bits == 16) {
+    const short	*s = (const short *)buf;
+    short	*d = (short *)&gainbuf[0];
+
+    for(i = 0; i < n; i++) {
+      float v = s[i] * gain;
+
+      d[i] = (short)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+    }
+  } else {
+    const unsigned char	*s = (const unsigned char *)buf;
+    unsigned char	*d = (unsigned char *)&gainbuf[0];
+
+    for(i = 0; i < n; i++) {
+      float v = (s[i] - 128) * gain;
+
+      d[i] = (unsigned char)(128 + (v > 127 ? 127 : (v < -128 ? -128 : v)));
+    }
+  }
+
+  return &gainbuf[0];
+}
+
+void EmuPlayer::outputpcm(const void *buf, unsigned long size)
+{
+  if(!size) return;
+  if(capture) fwrite(buf, 1, size, capture);
+  if(loudness) loudness->process(buf, size);
+  if(discard) return;
+  if(gain != 1) buf = amplify(buf, size);
+
+  PROBE_OUTPUT_START(size);
+  output(buf, size);
+  PROBE_OUTPUT_DONE(size);
 }
 
 void EmuPlayer::reset()
 {
-  minicnt = 0;
+  schedule.reset();
+  ticks = ticklimit = 0;
+  fadelen = 0;
 }
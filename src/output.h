@@ -20,8 +20,17 @@
 #ifndef H_OUTPUT
 #define H_OUTPUT
 
+#include <stdio.h>
+#include <string>
+#include <vector>
 #include <adplug/player.h>
 
+#include "stats.h"
+#include "silence.h"
+#include "idle.h"
+#include "loudness.h"
+#include "schedule.h"
+
 class Player
 {
 public:
@@ -34,6 +43,9 @@ public:
   virtual void frame() = 0;
   virtual Copl *get_opl() = 0;
   virtual void reset() {};
+
+  // Drop audio that the output has buffered, but not played yet
+  virtual void flush() {};
 };
 
 class EmuPlayer: public Player
@@ -41,7 +53,18 @@ class EmuPlayer: public Player
 private:
   Copl		*opl;
   char		*audiobuf;
+  FILE		*capture;
+  FrameStats	*stats;
+  SilenceFilter	*silence;
+  IdleTracker	*idle;
+  Copl		*verifyopl;
+  Loudness	*loudness;
+  bool		discard;
+  float		gain;
+  std::vector<char> gainbuf, verifybuf;
   unsigned long	buf_size, freq;
+  unsigned long	ticks, ticklimit;
+  unsigned long	fadetick, fadelen, fadepos;
   unsigned char	bits, channels;
 
 public:
@@ -54,6 +77,54 @@ public:
   virtual Copl *get_opl() { return opl; }
   virtual void reset();
 
+  // Send PCM data in the output format directly to the output.
+  void outputpcm(const void *buf, unsigned long size);
+
+  // Additionally write all rendered PCM data to 'f' (0 to stop).
+  void setcapture(FILE *f) { capture = f; }
+
+  // Record the time spent in each stage of frame() in 'st' (0 to stop).
+  void setstats(FrameStats *st) { stats = st; }
+
+  // Stop playing right after tick number 'n' of the player (0 for no
+  // limit). The last frame is shorter then. Cleared by reset().
+  void setticklimit(unsigned long n) { ticklimit = n; }
+
+  // Count 'n' ticks of the player that ran without rendering, e.g. when
+  // seeking, towards the tick limit and the fade out.
+  void skipticks(unsigned long n) { ticks += n; }
+
+  // Fade out over 'samples' samples, starting with tick number 'tick' of
+  // the player (0 samples for no fade out). Cleared by reset().
+  void setfade(unsigned long tick, unsigned long samples)
+    { fadetick = tick; fadelen = samples; fadepos = 0; }
+
+  // Pass all audio through 'filter' (0 to stop), which also ends the song
+  // after too much silence.
+  void setsilence(SilenceFilter *filter) { silence = filter; }
+  bool silenced() const { return silence && silence->stopped(); }
+
+  // Output silence instead of running the emulator while 'tracker' (0 to
+  // stop) finds the chip idle. With a 'verify' chip, which gets the same
+  // writes, run the emulator anyway and count the samples that weren't
+  // silent in the tracker. 'verify' skips the idle time instead, and the
+  // samples where it differs from full emulation are counted as well.
+  void setidle(IdleTracker *tracker, Copl *verify = 0)
+    { idle = tracker; verifyopl = verify; }
+
+  // Measure the loudness of all output in 'l' (0 to stop).
+  void setloudness(Loudness *l) { loudness = l; }
+
+  // Amplify the output by 'g', clipping where needed. Any capture gets the
+  // audio before that.
+  void setgain(double g) { gain = (float)g; }
+
+  // Capture and measure audio, but don't output it.
+  void setdiscard(bool d) { discard = d; }
+
+  // Tag the output with 'value' as 'name', if the output format has tags.
+  virtual void settag(const char *name, const std::string &value) {}
+
 protected:
   virtual void output(const void *buf, unsigned long size) = 0;
   // The output buffer is always of the size requested through the constructor.
@@ -62,7 +133,11 @@ protected:
   unsigned char getsampsize() { return (channels * (bits / 8)); }
 
 private:
-  static long minicnt;
+  void fadeout(char *buf, long samples);
+  void verifyskip(const char *buf, long samples);
+  const void *amplify(const void *buf, unsigned long size);
+
+  TickSchedule	schedule;
 };
 
 #endif
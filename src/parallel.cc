@@ -0,0 +1,165 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+#include "defines.h"
+#include "parallel.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+struct Worker {
+  pid_t		pid;
+  int		fd;		// output pipe, -1 when closed
+  std::string	buf;		// incomplete line
+};
+
+static void worker(unsigned int count, unsigned int id, unsigned int jobs,
+		   volatile unsigned int *next, WorkFunc work, int fd)
+{
+  FILE		*out = fdopen(fd, "w");
+  unsigned int	item;
+
+  if(!out) _exit(EXIT_FAILURE);
+
+  // Take items from the shared counter, or every jobs'th item without one
+  for(item = next ? __sync_fetch_and_add(next, 1) : id; item < count;
+      item = next ? __sync_fetch_and_add(next, 1) : item + jobs)
+    work(item, out);
+
+  _exit(fclose(out) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+bool run_parallel(unsigned int count, unsigned int jobs, WorkFunc work,
+		  FILE *out)
+{
+  std::vector<Worker>		workers;
+  std::vector<struct pollfd>	fds;
+  std::vector<unsigned int>	polled;		// worker of each fd
+  volatile unsigned int		*next = 0;
+  unsigned int			i, open;
+  pid_t				pid;
+  std::string::size_type	eol;
+  char				buf[65536];
+  ssize_t			n;
+  bool				ok = true;
+  int				status, p[2];
+
+  jobs = MAX(1, MIN(jobs, count));
+  fflush(out); fflush(stderr);	// don't duplicate buffered output
+
+#ifdef HAVE_SYS_MMAN_H
+  next = (volatile unsigned int *)mmap(NULL, sizeof(*next),
+				       PROT_READ | PROT_WRITE,
+				       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(next == MAP_FAILED) next = 0;
+  else *next = 0;
+#endif
+
+  for(i = 0; i < jobs; i++) {
+    Worker w;
+
+    if(pipe(p)) {
+      message(MSG_ERROR, "cannot create pipe -- %s", strerror(errno));
+      ok = false;
+      break;
+    }
+
+    w.pid = fork();
+    if(w.pid < 0) {
+      message(MSG_ERROR, "cannot start worker -- %s", strerror(errno));
+      close(p[0]); close(p[1]);
+      ok = false;
+      break;
+    }
+
+    if(!w.pid) {
+      close(p[0]);
+      for(unsigned int j = 0; j < workers.size(); j++)
+	close(workers[j].fd);
+      worker(count, i, jobs, next, work, p[1]);
+    }
+
+    close(p[1]);
+    w.fd = p[0];
+    workers.push_back(w);
+  }
+
+  // Forward complete lines of output until all workers are done
+  for(open = workers.size(); open;) {
+    fds.clear(); polled.clear();
+    for(i = 0; i < workers.size(); i++)
+      if(workers[i].fd >= 0) {
+	struct pollfd pfd = { workers[i].fd, POLLIN, 0 };
+	fds.push_back(pfd);
+	polled.push_back(i);
+      }
+
+    if(poll(&fds[0], fds.size(), -1) < 0) {
+      if(errno == EINTR) continue;
+      break;
+    }
+
+    for(i = 0; i < fds.size(); i++) {
+      Worker &w = workers[polled[i]];
+
+      if(!fds[i].revents) continue;
+
+      n = read(w.fd, buf, sizeof(buf));
+      if(n < 0 && errno == EINTR) continue;
+      if(n > 0) {
+	w.buf.append(buf, n);
+	if((eol = w.buf.rfind('\n')) != std::string::npos) {
+	  fwrite(w.buf.data(), 1, eol + 1, out);
+	  w.buf.erase(0, eol + 1);
+	}
+	continue;
+      }
+
+      // End of output. A missing final newline is added.
+      if(!w.buf.empty()) fprintf(out, "%s\n", w.buf.c_str());
+      close(w.fd);
+      w.fd = -1;
+      open--;
+    }
+    fflush(out);
+  }
+
+  for(i = 0; i < workers.size(); i++) {
+    while((pid = waitpid(workers[i].pid, &status, 0)) < 0 && errno == EINTR) ;
+    if(pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+      ok = false;
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  if(next) munmap((void *)next, sizeof(*next));
+#endif
+
+  return ok;
+}
@@ -0,0 +1,41 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * parallel.h - Processing of independent items in worker processes.
+ * AdPlug keeps global state, so separate processes are used instead of
+ * threads.
+ */
+
+#ifndef H_PARALLEL
+#define H_PARALLEL
+
+#include <stdio.h>
+
+// Processes item number 'item', writing its results to 'out'
+typedef void (*WorkFunc)(unsigned int item, FILE *out);
+
+// Run 'work' on items 0 to 'count' - 1 in 'jobs' worker processes. Each
+// worker takes the next unprocessed item when done with one. The output
+// of all workers is merged line by line into 'out', so lines are never
+// interleaved. Returns false if a worker failed.
+bool run_parallel(unsigned int count, unsigned int jobs, WorkFunc work,
+		  FILE *out);
+
+#endif
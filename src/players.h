@@ -28,7 +28,7 @@
 #include "config.h"
 
 // Enumerate ALL outputs (regardless of availability)
-enum Outputs {none, null, ao, oss, disk, esound, qsa, sdl, alsa, raw};
+enum Outputs {none, null, ao, oss, disk, esound, qsa, sdl, alsa, raw, http, hash};
 
 #define DEFAULT_DRIVER none
 
@@ -53,6 +53,16 @@ enum Outputs {none, null, ao, oss, disk, esound, qsa, sdl, alsa, raw};
 #define DEFAULT_DRIVER disk
 #endif
 
+// Hash writer (never the default)
+#ifdef DRIVER_HASH
+#include "hashsink.h"
+#endif
+
+// HTTP streamer (never the default)
+#ifdef DRIVER_HTTP
+#include "http.h"
+#endif
+
 // EsounD driver
 #ifdef DRIVER_ESOUND
 #include "esound.h"
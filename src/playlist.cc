@@ -0,0 +1,263 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Names are expanded only when the files before them have been played,
+ * so huge playlists and lists read from pipes start playing at once. The
+ * next few files are announced to the kernel, so they are read while the
+ * current one plays.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "defines.h"
+#include "playlist.h"
+
+// Deepest nesting of playlists, which also ends playlists including
+// themselves
+#define MAX_DEPTH	16
+
+// Number of files played that can be gone back to
+#define MAX_HISTORY	100
+
+static std::string lowercase(std::string s)
+{
+  for(std::string::size_type i = 0; i < s.size(); i++)
+    s[i] = tolower((unsigned char)s[i]);
+  return s;
+}
+
+static std::string dirname(const std::string &fn)
+{
+  std::string::size_type slash = fn.find_last_of('/');
+
+  return slash == std::string::npos ? "" : fn.substr(0, slash + 1);
+}
+
+static void announce(const std::string &fn)
+/* Have the kernel read file 'fn' in the background. */
+{
+#ifdef HAVE_POSIX_FADVISE
+  int fd = open(fn.c_str(), O_RDONLY);
+
+  if(fd < 0) return;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  close(fd);
+#endif
+}
+
+Playlist::Playlist(unsigned int nreadahead)
+  : pos(0), readahead(nreadahead), recursive(false)
+{
+}
+
+Playlist::~Playlist()
+{
+  unsigned int i;
+
+  for(i = 0; i < lists.size(); i++) release(lists[i]);
+  for(i = 0; i < sources.size(); i++) release(sources[i]);
+}
+
+bool Playlist::isplaylist(const std::string &fn)
+{
+  std::string::size_type dot = fn.find_last_of('.');
+
+  if(dot == std::string::npos) return false;
+  std::string ext = lowercase(fn.substr(dot));
+  return ext == ".m3u" || ext == ".m3u8";
+}
+
+Playlist::Source *Playlist::source(FILE *f, char delim, const std::string &dir,
+				   unsigned int depth)
+{
+  Source *s = new Source;
+
+  s->pos = 0; s->f = f; s->delim = delim; s->dir = dir; s->depth = depth;
+  return s;
+}
+
+void Playlist::release(Source *s)
+{
+  if(s->f && s->f != stdin) fclose(s->f);
+  delete s;
+}
+
+void Playlist::add(const std::string &name)
+{
+  if(lists.empty() || lists.back()->f)
+    lists.push_back(source(0, 0, "", 0));
+  lists.back()->names.push_back(name);
+}
+
+void Playlist::addfrom(const char *fn)
+{
+  FILE *f = strcmp(fn, "-") ? fopen(fn, "r") : stdin;
+
+  if(!f) {
+    message(MSG_ERROR, "cannot read file list -- %s: %s", fn,
+	    strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  lists.push_back(source(f, '\0', "", 0));
+}
+
+void Playlist::pushdir(const std::string &dir, unsigned int depth)
+{
+  DIR		*d = opendir(dir.c_str());
+  struct dirent	*de;
+  Source	*s;
+
+  if(!d) {
+    message(MSG_WARN, "cannot read directory -- %s: %s", dir.c_str(),
+	    strerror(errno));
+    return;
+  }
+
+  s = source(0, 0, dir + "/", depth);
+  while((de = readdir(d)))
+    if(strcmp(de->d_name, ".") && strcmp(de->d_name, ".."))
+      s->names.push_back(de->d_name);
+  closedir(d);
+
+  std::sort(s->names.begin(), s->names.end());
+  sources.push_back(s);
+}
+
+bool Playlist::read(Source *s, std::string &name)
+/*
+ * Get the next name of 's' into 'name'. Playlists may have comments and
+ * DOS line ends. Returns false once 's' is exhausted.
+ */
+{
+  char		*line = 0;
+  size_t	size = 0;
+  ssize_t	n;
+  bool		got = false;
+
+  if(!s->f) {
+    if(s->pos >= s->names.size()) return false;
+    name = s->names[s->pos++];
+    return true;
+  }
+
+  while(!got && (n = getdelim(&line, &size, s->delim, s->f)) > 0) {
+    name.assign(line, n);
+    while(!name.empty() && (name[name.size() - 1] == s->delim ||
+			    name[name.size() - 1] == '\r'))
+      name.erase(name.size() - 1);
+    got = !name.empty() && (s->delim == '\0' || name[0] != '#');
+  }
+
+  free(line);
+  return got;
+}
+
+bool Playlist::nextname(std::string &name, unsigned int &depth)
+/*
+ * Get the next unexpanded name from the innermost source into 'name',
+ * with its nesting depth in 'depth'. Exhausted sources are removed.
+ */
+{
+  Source *s;
+
+  while(!sources.empty() || !lists.empty()) {
+    s = sources.empty() ? lists.front() : sources.back();
+
+    if(read(s, name)) {
+      if(name[0] != '/') name = s->dir + name;
+      depth = s->depth;
+      return true;
+    }
+
+    release(s);
+    if(sources.empty()) lists.pop_front(); else sources.pop_back();
+  }
+
+  return false;
+}
+
+bool Playlist::fill()
+/* Expand names until the next file is found. Returns false at the end. */
+{
+  std::string	name;
+  unsigned int	depth;
+  struct stat	st;
+  FILE		*f;
+
+  while(nextname(name, depth)) {
+    if(isplaylist(name)) {
+      if(depth >= MAX_DEPTH)
+	message(MSG_WARN, "playlists nested too deep -- %s", name.c_str());
+      else if(!(f = fopen(name.c_str(), "r")))
+	message(MSG_WARN, "cannot read playlist -- %s: %s", name.c_str(),
+		strerror(errno));
+      else
+	sources.push_back(source(f, '\n', dirname(name), depth + 1));
+      continue;
+    }
+
+    if(recursive && !stat(name.c_str(), &st) && S_ISDIR(st.st_mode)) {
+      if(depth >= MAX_DEPTH)
+	message(MSG_WARN, "directories nested too deep -- %s", name.c_str());
+      else
+	pushdir(name, depth + 1);
+      continue;
+    }
+
+    announce(name);
+    ahead.push_back(name);
+    return true;
+  }
+
+  return false;
+}
+
+bool Playlist::next(std::string &fn)
+{
+  if(pos < played.size()) {		// after going back
+    fn = played[pos++];
+    return true;
+  }
+
+  while(ahead.size() <= readahead && fill()) ;
+  if(ahead.empty()) return false;
+
+  fn = ahead.front();
+  ahead.pop_front();
+  played.push_back(fn);
+  if(played.size() > MAX_HISTORY)
+    played.pop_front();
+  else
+    pos++;
+  return true;
+}
+
+void Playlist::back()
+{
+  pos = pos >= 2 ? pos - 2 : 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * playlist.h - The files to play, from the command line, M3U playlists,
+ * lists of names and directories, which are all read as playback goes on.
+ */
+
+#ifndef H_PLAYLIST
+#define H_PLAYLIST
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+class Playlist
+{
+public:
+  // Have the contents of the next 'nreadahead' files read in advance
+  Playlist(unsigned int nreadahead);
+  ~Playlist();
+
+  // Play all files below directories, instead of taking them as files
+  void setrecursive(bool r) { recursive = r; }
+
+  // Add a song file, M3U playlist or directory to the end
+  void add(const std::string &name);
+
+  // Add the NUL separated names read from file 'fn', or standard input
+  // if it is "-", to the end
+  void addfrom(const char *fn);
+
+  // Get the next file to play into 'fn'. Returns false at the end.
+  bool next(std::string &fn);
+
+  // Go back to the file before the one last returned by next()
+  void back();
+
+  // True if 'fn' is named like a playlist
+  static bool isplaylist(const std::string &fn);
+
+private:
+  // Names that are yet to be expanded: listed on the command line, read
+  // from a file or the entries of a directory
+  struct Source {
+    std::vector<std::string>	names;
+    unsigned int		pos;
+    FILE			*f;	// read from, 0 for 'names'
+    char			delim;	// between the names read
+    std::string			dir;	// relative names are relative to
+    unsigned int		depth;	// of nested playlists
+  };
+
+  static Source *source(FILE *f, char delim, const std::string &dir,
+			unsigned int depth);
+  static void release(Source *s);
+  static bool read(Source *s, std::string &name);
+  bool fill();
+  bool nextname(std::string &name, unsigned int &depth);
+  void pushdir(const std::string &dir, unsigned int depth);
+
+  std::deque<Source *>		lists;		// added, in order
+  std::vector<Source *>		sources;	// nested in the first list,
+						// innermost last
+  std::deque<std::string>	ahead;		// next files, read ahead
+  std::deque<std::string>	played;		// last few, for going back
+  unsigned int			pos, readahead;
+  bool				recursive;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * probes.h - USDT tracepoints for SystemTap, bpftrace and DTrace.
+ *
+ * The probes are nops in the code until a tracer attaches to them. When
+ * <sys/sdt.h> is not available, they compile to nothing. Probe
+ * arguments are not evaluated in that case, so they must not have side
+ * effects.
+ */
+
+#ifndef H_PROBES
+#define H_PROBES
+
+#include "defines.h"
+
+#ifdef ENABLE_USDT
+#  include <sys/sdt.h>
+
+// A file is about to be loaded
+#  define PROBE_LOAD_START(file)	DTRACE_PROBE1(adplay, load__start, file)
+// Loading is done; 'ok' is 0 if no loader took the file
+#  define PROBE_LOAD_DONE(file, ok)	DTRACE_PROBE2(adplay, load__done, file, ok)
+// The player is about to advance by one tick
+#  define PROBE_TICK_START()		DTRACE_PROBE(adplay, tick__start)
+// The tick is done; 'playing' is 0 once the song has ended
+#  define PROBE_TICK_DONE(playing)	DTRACE_PROBE1(adplay, tick__done, playing)
+// The emulator has rendered a chunk of 'samples' samples
+#  define PROBE_SYNTH(samples)		DTRACE_PROBE1(adplay, synth, samples)
+// A buffer of 'bytes' bytes is about to be passed to the output driver
+#  define PROBE_OUTPUT_START(bytes)	DTRACE_PROBE1(adplay, output__start, bytes)
+// The output driver has returned
+#  define PROBE_OUTPUT_DONE(bytes)	DTRACE_PROBE1(adplay, output__done, bytes)
+// The audio device ran out of data; 'err' is the driver's error code
+#  define PROBE_XRUN(err)		DTRACE_PROBE1(adplay, xrun, err)
+#else
+#  define PROBE_LOAD_START(file)	((void)0)
+#  define PROBE_LOAD_DONE(file, ok)	((void)0)
+#  define PROBE_TICK_START()	((void)0)
+#  define PROBE_TICK_DONE(playing)	((void)0)
+#  define PROBE_SYNTH(samples)	((void)0)
+#  define PROBE_OUTPUT_START(bytes)	((void)0)
+#  define PROBE_OUTPUT_DONE(bytes)	((void)0)
+#  define PROBE_XRUN(err)	((void)0)
+#endif
+
+#endif
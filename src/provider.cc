@@ -0,0 +1,260 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <binstr.h>
+
+#include "defines.h"
+#include "provider.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+/***** MemStream *****/
+
+// binisstream positions on the last byte when seeking to the end, which
+// makes CFileProvider::filesize() one short. Seek like a file instead.
+class MemStream: public binisstream
+{
+public:
+  MemStream(void *str, unsigned long len)
+    : binsbase(str, len), binisstream(str, len)
+  { }
+
+  virtual void seek(long p, Offset offs = Set)
+  {
+    if(offs == End) p += length;
+    else if(offs == Add) p += pos();
+
+    if(p >= 0 && p <= length)
+      spos = data + p;
+    else
+      binisstream::seek(p, Set);
+  }
+};
+
+/***** MmapProvider *****/
+
+MmapProvider::MmapProvider(const std::string &song)
+{
+  std::string entry;
+
+  split(song, songarchive, entry);
+}
+
+MmapProvider::~MmapProvider()
+{
+  std::map<std::string, Mapping>::iterator i;
+  std::map<std::string, Archive *>::iterator j;
+
+  // Archives point into their mapped files, so delete them first
+  for(j = archives.begin(); j != archives.end(); j++)
+    delete j->second;
+
+  for(i = files.begin(); i != files.end(); i++)
+    switch(i->second.kind) {
+#ifdef HAVE_SYS_MMAN_H
+    case Mapping::Mapped: munmap(i->second.data, i->second.size); break;
+#endif
+    case Mapping::Allocated: delete [] (char *)i->second.data; break;
+    default: break;
+    }
+}
+
+bool MmapProvider::split(const std::string &filename, std::string &archive,
+			 std::string &entry)
+/* Split "archive.zip:member" into its parts. */
+{
+  std::string::size_type pos;
+
+  for(pos = filename.find(':'); pos != std::string::npos;
+      pos = filename.find(':', pos + 1))
+    if(Archive::isarchive(filename.substr(0, pos))) {
+      archive = filename.substr(0, pos);
+      entry = filename.substr(pos + 1);
+      return true;
+    }
+
+  return false;
+}
+
+bool MmapProvider::load(const std::string &filename, Mapping &m) const
+{
+  std::string::size_type	dir = songarchive.find_last_of('/') + 1;
+  std::string			archive, entry;
+
+  if(split(filename, archive, entry))
+    return extract(archive, entry, m);
+
+  // Loaders look for companion files next to the song. For a song in the
+  // root of an archive, that is next to the archive.
+  if(!songarchive.empty() && filename.size() > dir &&
+     !filename.compare(0, dir, songarchive, 0, dir) &&
+     extract(songarchive, filename.substr(dir), m))
+    return true;
+
+  return map(filename, m);
+}
+
+bool MmapProvider::map(const std::string &filename, Mapping &m) const
+/*
+ * Map 'filename' into memory. Files that can't be mapped are read into
+ * a buffer instead.
+ */
+{
+  struct stat	st;
+  int		fd = ::open(filename.c_str(), O_RDONLY);
+  ssize_t	n;
+
+  if(fd < 0) return false;
+  if(fstat(fd, &st) || !S_ISREG(st.st_mode)) { ::close(fd); return false; }
+
+  m.size = st.st_size;
+  m.data = 0;
+  m.kind = Mapping::Allocated;
+
+#ifdef HAVE_SYS_MMAN_H
+  if(m.size) {
+    m.data = mmap(NULL, m.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(m.data == MAP_FAILED)
+      m.data = 0;
+    else {
+      m.kind = Mapping::Mapped;
+#ifdef MADV_WILLNEED
+      madvise(m.data, m.size, MADV_WILLNEED);	// read ahead all of it
+#endif
+    }
+  }
+#endif
+
+  if(m.kind != Mapping::Mapped) {
+    unsigned long len = 0;
+
+    m.data = new char [m.size + 1];
+    while(len < m.size &&
+	  ((n = read(fd, (char *)m.data + len, m.size - len)) > 0 ||
+	   (n < 0 && errno == EINTR)))
+      if(n > 0) len += n;
+    m.size = len;
+  }
+
+  ::close(fd);
+  return true;
+}
+
+Archive *MmapProvider::getarchive(const std::string &archive) const
+/* Return the archive 'archive', reading it on first use. */
+{
+  std::map<std::string, Archive *>::iterator i = archives.find(archive);
+  Mapping m;
+
+  if(i != archives.end()) return i->second;
+
+  // Failures are remembered as well, so they are only reported once
+  i = archives.insert(std::make_pair(archive, (Archive *)0)).first;
+  if(!map(archive, m)) {
+    message(MSG_WARN, "cannot open archive -- %s", archive.c_str());
+    return 0;
+  }
+
+  files.insert(std::make_pair(archive, m));
+  if(!(i->second = Archive::create(archive, m.data, m.size)))
+    message(MSG_WARN, "unsupported or corrupt archive -- %s",
+	    archive.c_str());
+
+  return i->second;
+}
+
+bool MmapProvider::extract(const std::string &archive,
+			   const std::string &entry, Mapping &m) const
+{
+  Archive	*a = getarchive(archive);
+  std::string	name;
+  bool		owned;
+
+  if(!a || !a->find(entry[0] == '/' ? entry.substr(1) : entry, name) ||
+     !a->extract(name, m.data, m.size, owned))
+    return false;
+
+  m.kind = owned ? Mapping::Allocated : Mapping::Archived;
+  return true;
+}
+
+binistream *MmapProvider::open(std::string filename) const
+{
+  std::map<std::string, Mapping>::iterator i = files.find(filename);
+  binistream *f;
+
+  if(i == files.end()) {
+    Mapping m;
+
+    if(!load(filename, m)) return 0;
+    i = files.insert(std::make_pair(filename, m)).first;
+  }
+
+  f = new MemStream(i->second.data, i->second.size);
+
+  // Open all files as little endian with IEEE floats by default
+  f->setFlag(binio::BigEndian, false); f->setFlag(binio::FloatIEEE);
+
+  return f;
+}
+
+void MmapProvider::close(binistream *f) const
+{
+  delete f;
+}
+
+void MmapProvider::add(const std::string &filename, const void *data,
+		       unsigned long size)
+{
+  Mapping m;
+
+  m.data = (void *)data; m.size = size; m.kind = Mapping::Borrowed;
+  files[filename] = m;
+}
+
+bool MmapProvider::hash(Hash64 &h) const
+/*
+ * Archives are left out, as their members are served and hashed on their
+ * own. The names are left out as well, so the same song hashes the same
+ * wherever it is.
+ */
+{
+  std::map<std::string, Mapping>::const_iterator	i;
+  char							size[32];
+  bool							any = false;
+
+  for(i = files.begin(); i != files.end(); i++) {
+    if(archives.count(i->first)) continue;
+    snprintf(size, sizeof(size), "%lu", i->second.size);
+    h.update(size, strlen(size) + 1);
+    h.update(i->second.data, i->second.size);
+    any = true;
+  }
+
+  return any;
+}
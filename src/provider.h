@@ -0,0 +1,78 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * provider.h - File provider that maps each song file into memory once
+ * and serves all of AdPlug's loaders from there. Also serves members of
+ * archives, named "archive.zip:path/in/archive".
+ */
+
+#ifndef H_PROVIDER
+#define H_PROVIDER
+
+#include <string>
+#include <map>
+#include <adplug/fprovider.h>
+
+#include "archive.h"
+#include "hash.h"
+
+class MmapProvider: public CFileProvider
+{
+public:
+  // Companion files of 'song' are searched in its archive, if any
+  MmapProvider(const std::string &song = std::string());
+  virtual ~MmapProvider();
+
+  virtual binistream *open(std::string filename) const;
+  virtual void close(binistream *f) const;
+
+  // Serve 'filename' from the 'size' bytes at 'data', which must stay
+  // valid for the lifetime of the provider.
+  void add(const std::string &filename, const void *data, unsigned long size);
+
+  // Hash the contents of all files served so far, i.e. the song and the
+  // companion files its loader opened, into 'h'. Returns false if no
+  // file was served.
+  bool hash(Hash64 &h) const;
+
+private:
+  struct Mapping {
+    void		*data;
+    unsigned long	size;
+    enum { Mapped, Allocated, Archived, Borrowed } kind;
+  };
+
+  static bool split(const std::string &filename, std::string &archive,
+		    std::string &entry);
+  bool load(const std::string &filename, Mapping &m) const;
+  bool map(const std::string &filename, Mapping &m) const;
+  bool extract(const std::string &archive, const std::string &entry,
+	       Mapping &m) const;
+  Archive *getarchive(const std::string &archive) const;
+
+  // Files stay mapped until the provider is destroyed, as loaders tend
+  // to open the same file several times
+  mutable std::map<std::string, Mapping>	files;
+  mutable std::map<std::string, Archive *>	archives;
+
+  std::string					songarchive;
+};
+
+#endif
@@ -18,6 +18,7 @@
  */
 
 #include "qsa.h"
+#include "probes.h"
 
 #include <errno.h>
 
@@ -104,6 +105,8 @@ void QSAPlayer::output(const void *buf, unsigned long size)
             if ((cstatus.status == SND_PCM_STATUS_UNDERRUN) ||
                 (cstatus.status == SND_PCM_STATUS_READY))
             {
+               if (cstatus.status == SND_PCM_STATUS_UNDERRUN)
+                  PROBE_XRUN(cstatus.status);
                if (snd_pcm_plugin_prepare (audio_handle, SND_PCM_CHANNEL_PLAYBACK) < 0 )
                {
                   return;
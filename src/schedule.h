@@ -0,0 +1,71 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * schedule.h - Interleaving of player ticks with the samples rendered
+ * between them, shared by everything that renders songs, so they all
+ * produce the same output.
+ */
+
+#ifndef H_SCHEDULE
+#define H_SCHEDULE
+
+// Rendering a song goes like this:
+//
+//   while(schedule.tick(freq)) p->update();
+//   n = schedule.samples(p->getrefresh(), max);
+//   ... render n samples ...
+class TickSchedule
+{
+public:
+  TickSchedule() : minicnt(0) { }
+
+  // Start over at the beginning of a song
+  void reset() { minicnt = 0; }
+
+  // If the player is due for a tick before any further samples at 'freq'
+  // Hz, account for the tick and return true. The caller then ticks the
+  // player.
+  bool tick(unsigned long freq)
+  {
+    if(minicnt >= 0) return false;
+    minicnt += freq;
+    return true;
+  }
+
+  // Whether a tick is due, after the caller stopped ticking early
+  bool due() const { return minicnt < 0; }
+
+  // Return the number of samples to render up to the next tick of a
+  // player at 'refresh' Hz, but at most 'max', and account for them.
+  long samples(float refresh, long max)
+  {
+    long n = (long)(minicnt / refresh + 4) & ~3, elapsed;
+
+    if(n > max) n = max;
+    elapsed = (long)(refresh * n);
+    minicnt -= elapsed > 1 ? elapsed : 1;
+    return n;
+  }
+
+private:
+  long	minicnt;
+};
+
+#endif
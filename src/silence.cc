@@ -0,0 +1,206 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Silence is audio below SILENCE_LEVEL. Silence at the end of a song is
+ * held back until either the song goes on, which sends it out, or the
+ * song ends, which drops it. The silence limit counts only silence after
+ * the last key on, so slowly rising notes don't end the song.
+ */
+
+#include <string.h>
+
+#include "defines.h"
+#include "output.h"
+#include "silence.h"
+
+// Loudest sample still considered silent, for 16 and 8 bit samples
+#define SILENCE_LEVEL16	16
+#define SILENCE_LEVEL8	1
+
+// Longest silence held back for trimming (in seconds). Longer silence is
+// sent out, to limit memory use.
+#define HOLD_MAX	60
+
+static int peak16(const short *s, unsigned long n)
+/* Largest magnitude of 'n' samples, in a loop simple enough to vectorize. */
+{
+  unsigned long	i;
+  int		m = 0;
+
+  for(i = 0; i < n; i++) {
+    int v = s[i] < 0 ? -s[i] : s[i];
+
+    m = v > m ? v : m;
+  }
+  return m;
+}
+
+static int peak8(const unsigned char *s, unsigned long n)
+{
+  unsigned long	i;
+  int		m = 0;
+
+  for(i = 0; i < n; i++) {
+    int v = s[i] < 128 ? 128 - s[i] : s[i] - 128;
+
+    m = v > m ? v : m;
+  }
+  return m;
+}
+
+/***** SilenceFilter *****/
+
+SilenceFilter::SilenceFilter(unsigned char nbits, unsigned char nchannels,
+			     unsigned long nfreq)
+  : bits(nbits), channels(nchannels), freq(nfreq), limit(0), quiet(0),
+    leading(false), trailing(false), started(false)
+{
+}
+
+void SilenceFilter::setlimit(double seconds)
+{
+  limit = (unsigned long)(seconds * freq);
+}
+
+void SilenceFilter::settrim(bool nleading, bool ntrailing)
+{
+  leading = nleading;
+  trailing = ntrailing;
+}
+
+void SilenceFilter::reset()
+{
+  quiet = 0;
+  started = false;
+  held.clear();
+}
+
+unsigned long SilenceFilter::head(const char *buf, unsigned long samples) const
+{
+  unsigned long n = samples * channels, i;
+
+  if(bits == 16) {
+    const short *s = (const short *)buf;
+
+    if(peak16(s, n) <= SILENCE_LEVEL16) return samples;
+    for(i = 0; peak16(s + i, 1) <= SILENCE_LEVEL16; i++) ;
+  } else {
+    const unsigned char *s = (const unsigned char *)buf;
+
+    if(peak8(s, n) <= SILENCE_LEVEL8) return samples;
+    for(i = 0; peak8(s + i, 1) <= SILENCE_LEVEL8; i++) ;
+  }
+
+  return i / channels;
+}
+
+unsigned long SilenceFilter::tail(const char *buf, unsigned long samples) const
+/* Only called for audio that isn't all silent. */
+{
+  unsigned long n = samples * channels, i;
+
+  if(bits == 16)
+    for(i = n; peak16((const short *)buf + i - 1, 1) <= SILENCE_LEVEL16; i--) ;
+  else
+    for(i = n; peak8((const unsigned char *)buf + i - 1, 1) <= SILENCE_LEVEL8;
+	i--) ;
+
+  return samples - (i + channels - 1) / channels;
+}
+
+void SilenceFilter::process(EmuPlayer &out, const char *buf,
+			    unsigned long size)
+{
+  unsigned long	framesize = channels * (bits / 8), samples = size / framesize;
+  unsigned long	h = head(buf, samples), t;
+
+  if(h == samples) {			// all silent
+    quiet += samples;
+    if(leading && !started) return;
+    if(!trailing) {
+      out.outputpcm(buf, size);
+      return;
+    }
+
+    if(held.size() + size > HOLD_MAX * freq * framesize) {
+      out.outputpcm(&held[0], held.size());
+      held.clear();
+    }
+    held.insert(held.end(), buf, buf + size);
+    return;
+  }
+
+  if(!held.empty()) {			// the song goes on
+    out.outputpcm(&held[0], held.size());
+    held.clear();
+  }
+
+  if(leading && !started) {
+    buf += h * framesize;
+    size -= h * framesize;
+  }
+  started = true;
+
+  t = tail(buf, size / framesize);
+  quiet = t;
+  if(trailing) {
+    out.outputpcm(buf, size - t * framesize);
+    held.assign(buf + size - t * framesize, buf + size);
+  } else
+    out.outputpcm(buf, size);
+}
+
+/***** KeyTracker *****/
+
+KeyTracker::KeyTracker(Copl *nopl, SilenceFilter *nfilter)
+  : opl(nopl), filter(nfilter)
+{
+  currType = opl->gettype();
+  memset(keys, 0, sizeof(keys));
+  memset(rhythm, 0, sizeof(rhythm));
+}
+
+void KeyTracker::write(int reg, int val)
+{
+  int chip = (reg & 0x100) ? 1 : currChip, r = reg & 0xff;
+
+  if(r >= 0xb0 && r <= 0xb8) {
+    if(val & ~keys[chip][r - 0xb0] & 0x20) filter->keyon();
+    keys[chip][r - 0xb0] = val;
+  } else if(r == 0xbd) {
+    if((val & 0x20) && (val & ~rhythm[chip] & 0x1f)) filter->keyon();
+    rhythm[chip] = val;
+  }
+
+  opl->write(reg, val);
+}
+
+void KeyTracker::setchip(int n)
+{
+  Copl::setchip(n);
+  opl->setchip(n);
+}
+
+void KeyTracker::init()
+{
+  memset(keys, 0, sizeof(keys));
+  memset(rhythm, 0, sizeof(rhythm));
+  opl->init();
+}
@@ -0,0 +1,84 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * silence.h - Detection and trimming of silence in the rendered audio.
+ */
+
+#ifndef H_SILENCE
+#define H_SILENCE
+
+#include <vector>
+#include <adplug/opl.h>
+
+class EmuPlayer;
+
+class SilenceFilter
+{
+public:
+  SilenceFilter(unsigned char nbits, unsigned char nchannels,
+		unsigned long nfreq);
+
+  // Stop after 'seconds' of silence (0 for never)
+  void setlimit(double seconds);
+  // Drop silence at the start and the end of songs
+  void settrim(bool nleading, bool ntrailing);
+
+  // Start a new song
+  void reset();
+
+  // A note was keyed on, so the song isn't over yet
+  void keyon() { quiet = 0; }
+
+  // Pass 'size' bytes of audio in 'buf' on to 'out', leaving out trimmed
+  // silence
+  void process(EmuPlayer &out, const char *buf, unsigned long size);
+
+  // True once the silence limit is reached
+  bool stopped() const { return limit && quiet >= limit; }
+
+private:
+  unsigned char		bits, channels;
+  unsigned long		freq, limit, quiet;	// in samples
+  bool			leading, trailing, started;
+  std::vector<char>	held;		// silence that may end the song
+
+  // Number of silent samples at the start and the end of 'buf'
+  unsigned long head(const char *buf, unsigned long samples) const;
+  unsigned long tail(const char *buf, unsigned long samples) const;
+};
+
+// Passes all register writes on to another chip, telling 'filter' about
+// every key on
+class KeyTracker: public Copl
+{
+public:
+  KeyTracker(Copl *nopl, SilenceFilter *nfilter);
+
+  virtual void write(int reg, int val);
+  virtual void setchip(int n);
+  virtual void init();
+
+private:
+  Copl		*opl;
+  SilenceFilter	*filter;
+  unsigned char	keys[2][9], rhythm[2];
+};
+
+#endif
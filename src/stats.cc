@@ -0,0 +1,142 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "defines.h"
+#include "stats.h"
+
+static const char *stage_names[FrameStats::Stages] = {
+  "update", "synth", "output"
+};
+
+static unsigned int bucket(uint64_t ns)
+{
+  unsigned int e = 0;
+
+  if(ns < 8) return ns;
+  while(ns >> (e + 1)) e++;		// e = log2(ns)
+  return (e - 2) * 8 + ((ns >> (e - 3)) & 7);
+}
+
+static uint64_t bucket_start(unsigned int i)
+{
+  if(i < 8) return i;
+  return (uint64_t)(8 + i % 8) << (i / 8 - 1);
+}
+
+void FrameStats::reset()
+{
+  memset(hist, 0, sizeof(hist));
+  audio = 0;
+  start = now();
+}
+
+uint64_t FrameStats::now()
+{
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+uint64_t FrameStats::add(Stage stage, uint64_t start)
+{
+  uint64_t	t = now(), ns = t - start;
+  Histogram	&h = hist[stage];
+
+  h.count++;
+  h.sum += ns;
+  h.max = MAX(h.max, ns);
+  h.bucket[MIN(bucket(ns), Buckets - 1)]++;
+  return t;
+}
+
+void FrameStats::merge(const FrameStats &st)
+{
+  unsigned int i, j;
+
+  for(i = 0; i < Stages; i++) {
+    hist[i].count += st.hist[i].count;
+    hist[i].sum += st.hist[i].sum;
+    hist[i].max = MAX(hist[i].max, st.hist[i].max);
+    for(j = 0; j < Buckets; j++)
+      hist[i].bucket[j] += st.hist[i].bucket[j];
+  }
+
+  audio += st.audio;
+}
+
+double FrameStats::percentile(const Histogram &h, double p) const
+/* Return the 'p'th percentile in microseconds, interpolated in buckets. */
+{
+  double		rank = p / 100 * h.count, lo, hi;
+  unsigned long		seen = 0;
+  unsigned int		i;
+
+  for(i = 0; i < Buckets; i++) {
+    if(seen + h.bucket[i] >= rank && h.bucket[i]) {
+      lo = bucket_start(i);
+      hi = MIN(i + 1 < Buckets ? bucket_start(i + 1) : h.max + 1, h.max + 1);
+      return (lo + (hi - lo) * (rank - seen) / h.bucket[i]) / 1000;
+    }
+    seen += h.bucket[i];
+  }
+
+  return h.max / 1000.0;
+}
+
+void FrameStats::report(FILE *out, const char *title) const
+{
+  struct rusage	ru;
+  double	wall = (now() - start) / 1e9, busy = 0;
+  unsigned int	i;
+
+  fprintf(out, "%s:\n"
+	  "  stage        calls   total ms   mean us    p50 us    p90 us"
+	  "    p99 us    max us\n", title);
+
+  for(i = 0; i < Stages; i++) {
+    const Histogram &h = hist[i];
+
+    if(!h.count) continue;
+    if(i != Output) busy += h.sum / 1e9;
+    fprintf(out, "  %-8s %9lu %10.1f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+	    stage_names[i], h.count, h.sum / 1e6, h.sum / 1e3 / h.count,
+	    percentile(h, 50), percentile(h, 90), percentile(h, 99),
+	    h.max / 1e3);
+  }
+
+  fprintf(out, "  %.1f s of audio in %.2f s", audio, wall);
+  if(wall > 0) fprintf(out, ", %.1fx realtime", audio / wall);
+  if(busy > 0) fprintf(out, " (%.1fx without output)", audio / busy);
+  if(!getrusage(RUSAGE_SELF, &ru))
+    fprintf(out, ", peak RSS %ld KB", (long)ru.ru_maxrss);
+  fputs("\n\n", out);
+}
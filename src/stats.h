@@ -0,0 +1,72 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * stats.h - Timing statistics of the render loop stages.
+ */
+
+#ifndef H_STATS
+#define H_STATS
+
+#include <stdio.h>
+#include <stdint.h>
+
+class FrameStats
+{
+public:
+  enum Stage { Update, Synth, Output, Stages };
+
+  FrameStats() { reset(); }
+
+  void reset();
+
+  // Monotonic time in nanoseconds
+  static uint64_t now();
+
+  // Record a call of 'stage' that started at 'start'. Returns the current
+  // time, to time a following stage.
+  uint64_t add(Stage stage, uint64_t start);
+
+  // Record 'seconds' of rendered audio
+  void addaudio(double seconds) { audio += seconds; }
+
+  // Add all records of 'st'
+  void merge(const FrameStats &st);
+
+  // Print the statistics, headed by 'title', to 'out'
+  void report(FILE *out, const char *title) const;
+
+private:
+  // Histograms have 8 logarithmic buckets per power of 2 nanoseconds
+  enum { Buckets = 8 * 62 };
+
+  struct Histogram {
+    unsigned long	count;
+    uint64_t		sum, max;
+    unsigned long	bucket[Buckets];
+  };
+
+  double percentile(const Histogram &h, double p) const;
+
+  Histogram	hist[Stages];
+  uint64_t	start;		// of recording
+  double	audio;		// in seconds
+};
+
+#endif
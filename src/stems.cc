@@ -0,0 +1,158 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "defines.h"
+#include "output.h"
+#include "loop.h"
+#include "schedule.h"
+#include "stems.h"
+
+// Largest number of samples rendered at once
+#define CHUNK		512
+
+// Register of the writes that stand for a chip reset
+#define INIT		0xffff
+
+// Key on bits of the drums in register 0xbd, in stem order
+static const int drum_bit[StemLog::Drums] = { 0x10, 0x08, 0x04, 0x02, 0x01 };
+static const char *drum_name[StemLog::Drums] = { "bd", "sd", "tt", "cy", "hh" };
+
+StemLog::StemLog(ChipType type)
+  : pos(0), length(0)
+{
+  currType = type;
+  init();
+}
+
+void StemLog::init()
+/* Resets before the song starts are left out, later ones are recorded. */
+{
+  Write w;
+
+  if(!pos) {
+    writes.clear();
+    memset(keyed, 0, sizeof(keyed));
+    return;
+  }
+
+  w.pos = pos; w.reg = INIT; w.val = 0;
+  writes.push_back(w);
+}
+
+void StemLog::write(int reg, int val)
+{
+  int	chip = (reg & 0x100) ? 1 : currChip, r = reg & 0xff, i;
+  Write	w;
+
+  if(r >= 0xb0 && r <= 0xb8 && (val & 0x20))
+    keyed[chip][r - 0xb0] = true;
+  if(r == 0xbd && (val & 0x20))
+    for(i = 0; i < Drums; i++)
+      if(val & drum_bit[i]) keyed[chip][Channels + i] = true;
+
+  w.pos = pos; w.reg = chip << 8 | r; w.val = val;
+  writes.push_back(w);
+}
+
+void StemLog::run(CPlayer *p, unsigned long freq, unsigned long ticklimit,
+		  unsigned int loops, unsigned long maxsamples)
+{
+  TickSchedule	schedule;
+  unsigned long	ticks = 0;
+  LoopCounter	counter;
+  bool		counting = !ticklimit, playing;
+
+  pos = 0;
+  while(pos < maxsamples) {
+    while((!ticklimit || ticks < ticklimit) && schedule.tick(freq)) {
+      playing = p->update();
+      ticks++;
+      if(counting && counter.tick(playing) >= loops) ticklimit = ticks;
+    }
+    if(schedule.due()) break;	// tick limit reached
+
+    pos += schedule.samples(p->getrefresh(), CHUNK);
+  }
+
+  length = MIN(pos, maxsamples);
+}
+
+std::vector<int> StemLog::used() const
+{
+  std::vector<int>	stems;
+  int			chip, i;
+
+  for(chip = 0; chip < 2; chip++)
+    for(i = 0; i < Stems; i++)
+      if(keyed[chip][i]) stems.push_back(chip * Stems + i);
+  return stems;
+}
+
+std::string StemLog::name(int stem)
+{
+  int	chip = stem / Stems, i = stem % Stems;
+  char	buf[16];
+
+  if(i < Channels)
+    snprintf(buf, sizeof(buf), "ch%d", chip * Channels + i + 1);
+  else
+    snprintf(buf, sizeof(buf), "%s%s", drum_name[i - Channels],
+	     chip ? "2" : "");
+  return buf;
+}
+
+void StemLog::render(int stem, Copl *opl, EmuPlayer &out,
+		     unsigned long samplesize) const
+{
+  std::vector<char>	buf(CHUNK * samplesize);
+  unsigned long		done = 0, until, n, i;
+  int			chip = stem / Stems, s = stem % Stems, drums;
+
+  // Drum key on bits to keep for this stem
+  drums = s >= Channels ? drum_bit[s - Channels] : 0;
+
+  opl->init();
+  for(i = 0; i <= writes.size(); i++) {
+    until = i < writes.size() ? MIN(writes[i].pos, length) : length;
+
+    for(; done < until; done += n) {
+      n = MIN(CHUNK, until - done);
+      opl->update((short *)&buf[0], n);
+      out.outputpcm(&buf[0], n * samplesize);
+    }
+
+    if(i < writes.size() && writes[i].reg == INIT)
+      opl->init();
+    else if(i < writes.size()) {
+      const Write	&w = writes[i];
+      int		c = w.reg >> 8, r = w.reg & 0xff, val = w.val;
+
+      if(r >= 0xb0 && r <= 0xb8 && (c != chip || s != r - 0xb0))
+	val &= ~0x20;
+      if(r == 0xbd)
+	val &= ~0x1f | (c == chip ? drums : 0);
+
+      opl->setchip(c);
+      opl->write(r, val);
+    }
+  }
+}
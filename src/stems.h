@@ -0,0 +1,77 @@
+/*
+ * AdPlay/UNIX - OPL2 audio player
+ * Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * stems.h - Rendering each channel of a song into its own stem, from a
+ * single run of its player.
+ */
+
+#ifndef H_STEMS
+#define H_STEMS
+
+#include <string>
+#include <vector>
+#include <adplug/opl.h>
+#include <adplug/player.h>
+
+class EmuPlayer;
+
+// Records all register writes with the sample they happen at. A stem is
+// one of the 9 melodic channels or 5 drums of either chip.
+class StemLog: public Copl
+{
+public:
+  enum { Channels = 9, Drums = 5, Stems = Channels + Drums };
+
+  StemLog(ChipType type);
+
+  virtual void write(int reg, int val);
+  virtual void init();
+
+  // Record the song of player 'p' at 'freq' Hz, scheduled like
+  // EmuPlayer::frame(). It ends after 'ticklimit' ticks, or if that's 0,
+  // at the song end of the player that completes 'loops' loops, but after
+  // 'maxsamples' samples at the latest.
+  void run(CPlayer *p, unsigned long freq, unsigned long ticklimit,
+	   unsigned int loops, unsigned long maxsamples);
+
+  // The stems that key on any note, numbered chip * Stems + stem
+  std::vector<int> used() const;
+
+  // Name of stem number 'stem', e.g. "ch3" or "bd"
+  static std::string name(int stem);
+
+  // Render stem number 'stem' with chip 'opl' to 'out', in samples of
+  // 'samplesize' bytes. All other channels are kept from keying on.
+  void render(int stem, Copl *opl, EmuPlayer &out,
+	      unsigned long samplesize) const;
+
+private:
+  struct Write {
+    unsigned long	pos;		// in samples
+    unsigned short	reg;		// with the chip in bit 8
+    unsigned char	val;
+  };
+
+  std::vector<Write>	writes;
+  unsigned long		pos, length;
+  bool			keyed[2][Stems];
+};
+
+#endif
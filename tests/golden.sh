@@ -0,0 +1,203 @@
+#!/bin/sh
+#
+# AdPlay/UNIX - OPL2 audio player
+# Copyright (C) 2026 Simon Peter <dn.tlp@gmx.net>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+#
+# golden.sh - Render the songs of the test corpus with every emulator and
+# sample format through the hash writer and compare the hashes to the
+# known good values in golden.txt.
+#
+# The corpus is taken from $ADPLAY_CORPUS, or the corpus/ subdirectory of
+# the source directory, which holds a few self-made songs. The exact output
+# depends on the AdPlug version, so known good values are kept per version.
+# Run with --update to record the current output as the known good values
+# of the AdPlug version in use. Once there are values for a version, every
+# case rendered with it must have one. Without values for the version in
+# use, songs are only checked to render the same way twice. Each song is
+# also rendered with --skip-idle=verify, which must render the same as full
+# emulation and find no time taken as idle that wasn't silent. The test is
+# skipped if there is no corpus. Song names must not contain whitespace.
+
+srcdir=${srcdir:-.}
+ADPLAY=${ADPLAY:-../src/adplay}
+CORPUS=${ADPLAY_CORPUS:-$srcdir/corpus}
+GOLDEN=$srcdir/golden.txt
+
+# Sample formats by name
+FORMATS="16s 16m 8m"
+
+format_args()
+{
+  case $1 in
+    16s) echo "--16bit --stereo" ;;
+    16m) echo "--16bit --mono" ;;
+    8m) echo "--8bit --mono" ;;
+  esac
+}
+
+# Current time in milliseconds, if date supports it
+now()
+{
+  t=`date +%s%N 2>/dev/null`
+  case $t in
+    *N|'') echo 0 ;;
+    *) expr $t / 1000000 ;;
+  esac
+}
+
+# Print the hash of 'song' rendered by emulator 'emu' in format 'fmt'
+render()
+{
+  "$ADPLAY" -q -q -O hash -e "$2" `format_args $3` -f 44100 -o \
+    "$CORPUS/$1" </dev/null 2>/dev/null
+}
+
+if test ! -d "$CORPUS"; then
+  echo "no test corpus in $CORPUS -- skipped"
+  exit 77
+fi
+
+# Use a scratch home directory, so the user's database is left out
+HOME=`mktemp -d ${TMPDIR:-/tmp}/adplay-check.XXXXXX` || exit 1
+export HOME
+trap 'rm -rf "$HOME"' 0
+
+emus=`"$ADPLAY" --help | sed -n 's/^Available emulators: //p'`
+adplug=`"$ADPLAY" --version | sed -n 's/^AdPlug //p'`
+songs=`cd "$CORPUS" && find . -type f | sed 's|^\./||' | sort`
+
+if test -z "$adplug"; then
+  echo "cannot tell the AdPlug version of $ADPLAY"
+  exit 1
+fi
+
+if test "x$1" = x--update; then
+  tmp=$GOLDEN.tmp
+  {
+    echo "# Known good hashes of the test corpus:"
+    echo "# AdPlug version, song, emulator, format, hash"
+    # Keep the values of other versions
+    grep -v '^#' "$GOLDEN" | grep -v "^$adplug "
+    for song in $songs; do
+      for emu in $emus; do
+	for fmt in $FORMATS; do
+	  h=`render "$song" $emu $fmt` && test -n "$h" && \
+	    echo "$adplug $song $emu $fmt $h"
+	done
+      done
+    done
+  } > "$tmp"
+  mv "$tmp" "$GOLDEN" || exit 1
+  echo "`grep -c "^$adplug " "$GOLDEN"` cases of AdPlug $adplug recorded" \
+    "in $GOLDEN"
+  exit 0
+fi
+
+# Without values for this AdPlug version, fall back to repeatability
+if grep "^$adplug " "$GOLDEN" >/dev/null; then
+  known=yes
+else
+  known=no
+  echo "no known good hashes for AdPlug $adplug, run $0 --update to" \
+    "record them"
+fi
+
+pass=0 fail=0 skip=0
+exec 3<"$GOLDEN"
+while read version song emu fmt expected <&3; do
+  case $version in '#'*|'') continue ;; esac
+  test "x$version" = "x$adplug" || continue
+
+  if test ! -f "$CORPUS/$song"; then
+    skip=`expr $skip + 1`
+    continue
+  fi
+
+  start=`now`
+  h=`render "$song" $emu $fmt`
+  ms=`expr \`now\` - $start`
+
+  if test "x$h" = "x$expected"; then
+    pass=`expr $pass + 1`
+    echo "PASS: $song $emu $fmt ($ms ms)"
+  else
+    fail=`expr $fail + 1`
+    echo "FAIL: $song $emu $fmt ($ms ms): expected $expected, got ${h:-nothing}"
+  fi
+done
+exec 3<&-
+
+for song in $songs; do
+  for emu in $emus; do
+    for fmt in $FORMATS; do
+      grep "^$adplug $song $emu $fmt " "$GOLDEN" >/dev/null && continue
+
+      # Like --update, leave out what the emulator can't render
+      start=`now`
+      h=`render "$song" $emu $fmt` && test -n "$h" || continue
+      ms=`expr \`now\` - $start`
+
+      if test $known = yes; then
+	fail=`expr $fail + 1`
+	echo "FAIL: $song $emu $fmt ($ms ms): no known good hash for" \
+	  "AdPlug $adplug, run $0 --update"
+	continue
+      fi
+
+      again=`render "$song" $emu $fmt`
+      if test "x$h" = "x$again"; then
+	pass=`expr $pass + 1`
+	echo "PASS: $song $emu $fmt ($ms ms, repeatable)"
+      else
+	fail=`expr $fail + 1`
+	echo "FAIL: $song $emu $fmt ($ms ms): got $h, then ${again:-nothing}"
+      fi
+    done
+  done
+done
+
+# Idle time must be silent. Verifying keeps the emulator running, so the
+# output must not change.
+for song in $songs; do
+  for emu in $emus; do
+    h=`render "$song" $emu 16s` && test -n "$h" || continue
+
+    start=`now`
+    v=`"$ADPLAY" -O hash -e $emu \`format_args 16s\` -f 44100 -o \
+      --skip-idle=verify "$CORPUS/$song" </dev/null 2>"$HOME/verify.log"`
+    ms=`expr \`now\` - $start`
+    wrong=`grep 'were not silent' "$HOME/verify.log"`
+    differed=`sed -n 's/^.*: \(.* differed from full emulation.*\) -- .*$/\1/p' \
+      "$HOME/verify.log"`
+
+    if test -n "$wrong"; then
+      fail=`expr $fail + 1`
+      echo "FAIL: $song $emu skip-idle ($ms ms): $wrong"
+    elif test "x$v" != "x$h"; then
+      fail=`expr $fail + 1`
+      echo "FAIL: $song $emu skip-idle ($ms ms): expected $h, got ${v:-nothing}"
+    else
+      pass=`expr $pass + 1`
+      echo "PASS: $song $emu skip-idle ($ms ms${differed:+, $differed})"
+    fi
+  done
+done
+
+echo "$pass passed, $fail failed, $skip not in corpus"
+test $fail -eq 0 || exit 1
+test $pass -gt 0 || exit 77
+exit 0